@@ -0,0 +1,120 @@
+//------------------------------------------------------------------------------------------------
+//---- event_trace.h - Core 0 timestamped event ring                                          ----
+//------------------------------------------------------------------------------------------------
+//---- Core 0 records into its own ring so no locking is needed; an event is two stores       ----
+//---- of a DWT cycle count and an 8-bit id with a 24-bit argument. Not for use from IRQs.    ----
+//---- Build with EVENT_TRACE_ENABLED=0 and every hook compiles away, 1 traces blocks, erases ----
+//---- and SD commands, 2 adds the EVENT_TRACE_DETAIL hooks around every flash word.          ----
+//---- The rings and dump format keep a per-core slot, EVENT_TRACE_CORES, for later use.      ----
+//------------------------------------------------------------------------------------------------
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+//
+#include "ff.h"
+
+#ifndef EVENT_TRACE_ENABLED
+#define EVENT_TRACE_ENABLED		(0)
+#endif
+
+// Entries per core, must be a power of two and a multiple of 64 (whole sectors when dumped).
+#ifndef EVENT_TRACE_ENTRIES
+#define EVENT_TRACE_ENTRIES		(4096)
+#endif
+
+// Core 1 only draws from the render queue and never reaches a hook, so it gets no ring.
+#define EVENT_TRACE_CORES		(1)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Keep in step with EVENT_NAMES in FlashCartProgrammer/Tools/trace_decode.py
+typedef enum
+{
+	EVENT_MARK = 0,					// arg = caller defined
+
+	EVENT_FLASH_COMMAND,			// arg = command byte (detail)
+	EVENT_FLASH_PROGRAM_BEGIN,		// arg = flash address (detail)
+	EVENT_FLASH_PROGRAM_END,		// arg = flash address (detail)
+	EVENT_FLASH_READ_BEGIN,			// arg = flash address
+	EVENT_FLASH_READ_END,			// arg = length
+	EVENT_FLASH_ERASE_BEGIN,		// arg = sector address
+	EVENT_FLASH_ERASE_END,			// arg = 1 if the erase completed
+	EVENT_FLASH_FAIL,				// arg = flash address, see FlashGetStatus
+
+	EVENT_SPI_TRANSFER_BEGIN,		// arg = length
+	EVENT_SPI_TRANSFER_END,			// arg = 1 on success, 0 on timeout
+	EVENT_SD_CMD_BEGIN,				// arg = command index
+	EVENT_SD_CMD_END,				// arg = status (sign extended from 24 bits)
+	EVENT_DISK_READ_BEGIN,			// arg = start sector (low 24 bits)
+	EVENT_DISK_READ_END,			// arg = sector count
+
+	EVENT_FLASH_BLOCK_BEGIN,		// arg = flash address
+	EVENT_FLASH_BLOCK_END,			// arg = 1 if it programmed
+} EVENT_ID;
+
+typedef struct
+{
+	uint32_t	cycles;				// DWT cycle counter of the recording core
+	uint32_t	event;				// id << 24 | arg & 0xFFFFFF
+} EVENT_TRACE_ENTRY;
+
+typedef struct
+{
+	uint32_t			head;		// Total events recorded, the ring holds the newest
+	EVENT_TRACE_ENTRY	entry[EVENT_TRACE_ENTRIES];
+} EVENT_TRACE_RING;
+
+// Resets core 0's ring and starts its cycle counter. Call once from core 0.
+void event_trace_init(void);
+
+// Writes the rings to a file: one header sector then each ring as it sits in memory.
+// Recording is paused for the duration so the dump's own SD traffic is not traced.
+FRESULT event_trace_dump(const TCHAR* pszPath);
+
+#if EVENT_TRACE_ENABLED
+
+#include "hardware/structs/m33.h"
+#include "hardware/structs/sio.h"
+
+extern EVENT_TRACE_RING event_trace_ring[EVENT_TRACE_CORES];
+extern volatile bool event_trace_enabled;
+
+//------------------------------------------------------------------------------------------------
+//---- event_trace_record                                                                     ----
+//------------------------------------------------------------------------------------------------
+static inline void event_trace_record(const EVENT_ID eID, const uint32_t uArg)
+{
+	const uint32_t uCore = sio_hw->cpuid;
+
+	if (!event_trace_enabled || (uCore >= EVENT_TRACE_CORES))
+		return;
+
+	EVENT_TRACE_RING* pRing = &event_trace_ring[uCore];
+	const uint32_t uHead = pRing->head;
+	EVENT_TRACE_ENTRY* pEntry = &pRing->entry[uHead & (EVENT_TRACE_ENTRIES - 1)];
+
+	pEntry->cycles = m33_hw->dwt_cyccnt;
+	pEntry->event = ((uint32_t)eID << 24) | (uArg & 0x00FFFFFF);
+	pRing->head = uHead + 1;
+}
+
+#define EVENT_TRACE(eID, uArg)	event_trace_record((eID), (uint32_t)(uArg))
+
+#else
+
+#define EVENT_TRACE(eID, uArg)	((void)0)
+
+#endif
+
+#if EVENT_TRACE_ENABLED >= 2
+#define EVENT_TRACE_DETAIL(eID, uArg)	EVENT_TRACE((eID), (uArg))
+#else
+#define EVENT_TRACE_DETAIL(eID, uArg)	((void)0)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
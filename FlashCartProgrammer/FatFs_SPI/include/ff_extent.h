@@ -0,0 +1,54 @@
+//------------------------------------------------------------------------------------------------
+//---- ff_extent.h - Raw LBA extent access to FatFs files                                     ----
+//------------------------------------------------------------------------------------------------
+//---- ROM images are almost always stored contiguously on a freshly written card, so once   ----
+//---- the cluster chain has been walked (CLMT) the data can be read straight from the card  ----
+//---- with large multi-block transfers, bypassing f_read's per-cluster splitting and copies. ----
+//------------------------------------------------------------------------------------------------
+#pragma once
+
+#include "ff.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// More fragments than this and the image falls back to plain f_read.
+#define FF_IMAGE_MAX_EXTENTS	(8)
+
+typedef struct
+{
+	LBA_t	lba;				// First sector of the run on the card
+	DWORD	sectors;			// Length of the run in sectors
+} FF_EXTENT;
+
+typedef struct
+{
+	FIL			fil;
+	FSIZE_t		size;			// File size in bytes
+	UINT		count;			// Extents in use, 0 if the file is too fragmented
+	FF_EXTENT	extent[FF_IMAGE_MAX_EXTENTS];
+} FF_IMAGE;
+
+// Opens a file for reading and maps its clusters to LBA extents.
+FRESULT ff_image_open(FF_IMAGE* pImage, const TCHAR* pszPath);
+
+// Creates a file of exactly uSize bytes, preallocated as one contiguous run with f_expand so the
+// FAT is written up front and ff_image_write never touches it. Falls back to f_write if the
+// volume has no contiguous space that large.
+FRESULT ff_image_create(FF_IMAGE* pImage, const TCHAR* pszPath, FSIZE_t uSize);
+
+// Closing a created image writes back its directory entry (and the FAT window left by f_expand).
+FRESULT ff_image_close(FF_IMAGE* pImage);
+
+// Reads uLength bytes from uOffset, which must be sector aligned. Runs within an extent go to the
+// card as single multi-block reads. pBuffer must have room for uLength rounded up to a whole sector.
+FRESULT ff_image_read(FF_IMAGE* pImage, void* pBuffer, FSIZE_t uOffset, UINT uLength, UINT* puRead);
+
+// Writes uLength bytes at uOffset, which must be sector aligned, as raw multi-block writes. pBuffer
+// must hold uLength rounded up to a whole sector; anything past the file size lands in slack space.
+FRESULT ff_image_write(FF_IMAGE* pImage, const void* pBuffer, FSIZE_t uOffset, UINT uLength, UINT* puWritten);
+
+#ifdef __cplusplus
+}
+#endif
@@ -167,6 +167,7 @@ specific language governing permissions and limitations under the License.
 //
 #include "hw_config.h"  // Hardware Configuration of the SPI and SD Card "objects"
 #include "my_debug.h"
+#include "event_trace.h"
 #include "sd_spi.h"
 //
 #include "sd_card.h"
@@ -346,6 +347,9 @@ static uint8_t sd_cmd_spi(sd_card_t *pSD, cmdSupported cmd, uint32_t arg) {
     return response;
 }
 
+#define SD_COMMAND_RETRIES 3 /*!< Times SPI cmd is retried when there is no response */
+#define SD_COMMAND_TIMEOUT 2000 /*!< Timeout in ms for response */
+
 static bool sd_wait_ready(sd_card_t *pSD, int timeout) {
     char resp;
 
@@ -383,6 +387,25 @@ static void sd_release(sd_card_t *pSD) {
     sd_spi_release(pSD);
 }
 
+/* Close an open CMD25 session with the 'Stop Tran' token.
+ * The busy period that follows Stop Tran is left for the next command's
+ * sd_wait_ready() so the caller is not blocked here.
+ */
+static void sd_stop_write_session(sd_card_t *pSD) {
+    if (!pSD->wr_session_open) return;
+    pSD->wr_session_open = false;
+
+    // The card only samples the token once the previous block has programmed
+    if (false == sd_wait_ready(pSD, SD_COMMAND_TIMEOUT)) {
+        DBG_PRINTF("%s:%d: Card not ready yet\r\n", __FILE__, __LINE__);
+    }
+    sd_spi_write(pSD, SPI_STOP_TRAN);
+    // One stuff byte precedes the busy signal after Stop Tran
+    sd_spi_write(pSD, SPI_FILL_CHAR);
+    // Some SD cards want to be deselected between every bus transaction:
+    sd_spi_deselect_pulse(pSD);
+}
+
 #if 0
 static const char *cmd2str(const cmdSupported cmd) {
     switch (cmd) {
@@ -447,16 +470,16 @@ static const char *cmd2str(const cmdSupported cmd) {
 }
 #endif
 
-#define SD_COMMAND_RETRIES 3 /*!< Times SPI cmd is retried when there is no response */
-#define SD_COMMAND_TIMEOUT 2000 /*!< Timeout in ms for response */
-
-static int sd_cmd(sd_card_t *pSD, const cmdSupported cmd, uint32_t arg,
-                  bool isAcmd, uint32_t *resp) {
+static int in_sd_cmd(sd_card_t *pSD, const cmdSupported cmd, uint32_t arg,
+                     bool isAcmd, uint32_t *resp) {
     TRACE_PRINTF("%s(%s(0x%08lx)): ", __FUNCTION__, cmd2str(cmd), arg);
 
     int32_t status = SD_BLOCK_DEVICE_ERROR_NONE;
     uint32_t response;
 
+    // Any command ends an open multi-block write
+    sd_stop_write_session(pSD);
+
     // No need to wait for card to be ready when sending the stop command
     if (CMD12_STOP_TRANSMISSION != cmd) {
         if (false == sd_wait_ready(pSD, SD_COMMAND_TIMEOUT)) {
@@ -611,6 +634,14 @@ static int sd_cmd(sd_card_t *pSD, const cmdSupported cmd, uint32_t arg,
     return status;
 }
 
+static int sd_cmd(sd_card_t *pSD, const cmdSupported cmd, uint32_t arg,
+                  bool isAcmd, uint32_t *resp) {
+    EVENT_TRACE(EVENT_SD_CMD_BEGIN, cmd);
+    int status = in_sd_cmd(pSD, cmd, arg, isAcmd, resp);
+    EVENT_TRACE(EVENT_SD_CMD_END, status);
+    return status;
+}
+
 /* Return non-zero if the SD-card is present. */
 bool sd_card_detect(sd_card_t *pSD) {
     TRACE_PRINTF("> %s\r\n", __FUNCTION__);
@@ -628,6 +659,7 @@ bool sd_card_detect(sd_card_t *pSD) {
         // The socket is now empty
         pSD->m_Status |= (STA_NODISK | STA_NOINIT);
         pSD->card_type = SDCARD_NONE;
+        pSD->wr_session_open = false;
         printf("No SD card detected!\r\n");
         return false;
     }
@@ -874,8 +906,8 @@ static int in_sd_read_blocks(sd_card_t *pSD, uint8_t *buffer,
     // receive the data : one block at a time
     int rd_status = 0;
     while (blockCnt) {
-        if (0 != sd_read_block(pSD, buffer, _block_size)) {
-            rd_status = SD_BLOCK_DEVICE_ERROR_NO_RESPONSE;
+        // Keep CRC errors distinct so the caller can slow the clock down
+        if (0 != (rd_status = sd_read_block(pSD, buffer, _block_size))) {
             break;
         }
         buffer += _block_size;
@@ -888,12 +920,31 @@ static int in_sd_read_blocks(sd_card_t *pSD, uint8_t *buffer,
     return rd_status ? rd_status : status;
 }
 
+/*!< Times a transfer is retried at a lower SPI clock after a link error */
+#define SD_CLOCK_FALLBACK_RETRIES 4
+
+/* CRC errors are what marginal wiring produces at too high a clock; those are
+ * worth retrying at the next rate down. A missing data token is more often a
+ * pulled card than the link, so it doesn't cost the rest of the session its
+ * clock. sd_init starts back at full speed for the next card either way. */
+static bool sd_should_step_down(sd_card_t *pSD, int status, int attempt) {
+    if (SD_BLOCK_DEVICE_ERROR_CRC != status)
+        return false;
+    if (attempt >= SD_CLOCK_FALLBACK_RETRIES)
+        return false;
+    return sd_spi_step_down_frequency(pSD);
+}
+
 int sd_read_blocks(sd_card_t *pSD, uint8_t *buffer, uint64_t ulSectorNumber,
                    uint32_t ulSectorCount) {
     sd_acquire(pSD);
     TRACE_PRINTF("sd_read_blocks(0x%p, 0x%llx, 0x%lx)\r\n", buffer,
                  ulSectorNumber, ulSectorCount);
-    int status = in_sd_read_blocks(pSD, buffer, ulSectorNumber, ulSectorCount);
+    int status;
+    int attempt = 0;
+    do {
+        status = in_sd_read_blocks(pSD, buffer, ulSectorNumber, ulSectorCount);
+    } while (sd_should_step_down(pSD, status, attempt++));
     sd_release(pSD);
     return status;
 }
@@ -924,15 +975,17 @@ static uint8_t sd_write_block(sd_card_t *pSD, const uint8_t *buffer,
     // check the response token
     response = sd_spi_write(pSD, SPI_FILL_CHAR);
 
-    // Wait for last block to be written
-    if (false == sd_wait_ready(pSD, SD_COMMAND_TIMEOUT)) {
-        DBG_PRINTF("%s:%d: Card not ready yet\r\n", __FILE__, __LINE__);
-    }
+    // The card now programs the block. Waiting for that is deferred until the
+    // bus is next needed, so the caller can prepare more data meanwhile.
     return (response & SPI_DATA_RESPONSE_MASK);
 }
 
 /** Program blocks to a block device
  *
+ *  Writes always go through a CMD25 session which is left open on return.
+ *  A following write to the next LBA carries straight on with more data
+ *  tokens; anything else closes the session first (see sd_cmd). The card's
+ *  busy time after each block is only waited for when the bus is next used.
  *
  *  @param buffer       Buffer of data to write to blocks
  *  @param ulSectorNumber     Logical Address of block to begin writing to (LBA)
@@ -957,31 +1010,21 @@ static int in_sd_write_blocks(sd_card_t *pSD, const uint8_t *buffer,
     uint8_t response;
     uint64_t addr;
 
-    // SDSC Card (CCS=0) uses byte unit address
-    // SDHC and SDXC Cards (CCS=1) use block unit address (512 Bytes unit)
-    if (SDCARD_V2HC == pSD->card_type) {
-        addr = ulSectorNumber;
-    } else {
-        addr = ulSectorNumber * _block_size;
-    }
-    // Send command to perform write operation
-    if (blockCnt == 1) {
-        // Single block write command
-        if (SD_BLOCK_DEVICE_ERROR_NONE !=
-            (status = sd_cmd(pSD, CMD24_WRITE_BLOCK, addr, false, 0))) {
-            return status;
-        }
-        // Write data
-        response = sd_write_block(pSD, buffer, SPI_START_BLOCK, _block_size);
-
-        // Only CRC and general write error are communicated via response token
-        if (response != SPI_DATA_ACCEPTED) {
-            DBG_PRINTF("Single Block Write failed: 0x%x \r\n", response);
-            status = SD_BLOCK_DEVICE_ERROR_WRITE;
+    if (!pSD->wr_session_open || pSD->wr_session_next != ulSectorNumber) {
+        // SDSC Card (CCS=0) uses byte unit address
+        // SDHC and SDXC Cards (CCS=1) use block unit address (512 Bytes unit)
+        if (SDCARD_V2HC == pSD->card_type) {
+            addr = ulSectorNumber;
+        } else {
+            addr = ulSectorNumber * _block_size;
         }
-    } else {
         // Pre-erase setting prior to multiple block write operation
-        sd_cmd(pSD, ACMD23_SET_WR_BLK_ERASE_COUNT, blockCnt, 1, 0);
+        // (closes any session still open at another LBA)
+        if (blockCnt > 1) {
+            sd_cmd(pSD, ACMD23_SET_WR_BLK_ERASE_COUNT, blockCnt, 1, 0);
+        } else {
+            sd_stop_write_session(pSD);
+        }
 
         // Some SD cards want to be deselected between every bus transaction:
         sd_spi_deselect_pulse(pSD);
@@ -991,26 +1034,35 @@ static int in_sd_write_blocks(sd_card_t *pSD, const uint8_t *buffer,
             (status = sd_cmd(pSD, CMD25_WRITE_MULTIPLE_BLOCK, addr, false, 0))) {
             return status;
         }
-        // Write the data: one block at a time
-        do {
-            response = sd_write_block(pSD, buffer, SPI_START_BLK_MUL_WRITE, _block_size);
-            if (response != SPI_DATA_ACCEPTED) {
-                DBG_PRINTF("Multiple Block Write failed: 0x%x\r\n", response);
-                status = SD_BLOCK_DEVICE_ERROR_WRITE;
-                break;
-            }
-            buffer += _block_size;
-        } while (--blockCnt);  // Send all blocks of data
-        /* In a Multiple Block write operation, the stop transmission will be
-         * done by sending 'Stop Tran' token instead of 'Start Block' token at
-         * the beginning of the next block
-         */
-        sd_spi_write(pSD, SPI_STOP_TRAN);
+        pSD->wr_session_open = true;
+    } else if (false == sd_wait_ready(pSD, SD_COMMAND_TIMEOUT)) {
+        // Continuing the open session: the previous block must have programmed
+        DBG_PRINTF("%s:%d: Card not ready yet\r\n", __FILE__, __LINE__);
+    }
+    // Write the data: one block at a time
+    for (;;) {
+        response = sd_write_block(pSD, buffer, SPI_START_BLK_MUL_WRITE, _block_size);
+        // Only CRC and general write error are communicated via response token
+        if (response != SPI_DATA_ACCEPTED) {
+            DBG_PRINTF("Multiple Block Write failed: 0x%x\r\n", response);
+            status = (SPI_DATA_CRC_ERROR == response) ? SD_BLOCK_DEVICE_ERROR_CRC
+                                                      : SD_BLOCK_DEVICE_ERROR_WRITE;
+            break;
+        }
+        buffer += _block_size;
+        ++ulSectorNumber;
+        if (0 == --blockCnt) break;
+        // Card must finish the block before it takes the next data token
+        if (false == sd_wait_ready(pSD, SD_COMMAND_TIMEOUT)) {
+            DBG_PRINTF("%s:%d: Card not ready yet\r\n", __FILE__, __LINE__);
+        }
+    }
+    pSD->wr_session_next = ulSectorNumber;
+    if (SD_BLOCK_DEVICE_ERROR_NONE != status) {
+        // Abandon the session and find out why the card rejected the block
+        uint32_t stat = 0;
+        sd_cmd(pSD, CMD13_SEND_STATUS, 0, false, &stat);
     }
-    uint32_t stat = 0;
-    // Some SD cards want to be deselected between every bus transaction:
-    sd_spi_deselect_pulse(pSD);
-    status = sd_cmd(pSD, CMD13_SEND_STATUS, 0, false, &stat);
     return status;
 }
 
@@ -1019,11 +1071,89 @@ int sd_write_blocks(sd_card_t *pSD, const uint8_t *buffer,
     sd_acquire(pSD);
     TRACE_PRINTF("sd_write_blocks(0x%p, 0x%llx, 0x%lx)\r\n", buffer,
                  ulSectorNumber, blockCnt);
-    int status = in_sd_write_blocks(pSD, buffer, ulSectorNumber, blockCnt);
+    int status;
+    int attempt = 0;
+    do {
+        // A failed request closed its session, so a retry starts a fresh one
+        status = in_sd_write_blocks(pSD, buffer, ulSectorNumber, blockCnt);
+    } while (sd_should_step_down(pSD, status, attempt++));
     sd_release(pSD);
     return status;
 }
 
+/* Flush the write pipeline: end any open CMD25 session, let the card finish
+ * programming and report its status. FatFs reaches this via CTRL_SYNC. */
+int sd_sync(sd_card_t *pSD) {
+    int status = SD_BLOCK_DEVICE_ERROR_NONE;
+    sd_acquire(pSD);
+    if (pSD->wr_session_open) {
+        uint32_t stat = 0;
+        // sd_cmd sends Stop Tran and waits for the card to go ready
+        status = sd_cmd(pSD, CMD13_SEND_STATUS, 0, false, &stat);
+    }
+    sd_release(pSD);
+    return status;
+}
+
+/* SPI mode clock limits: 25 MHz in default speed, 50 MHz once switched to
+ * high speed. The SPI divider picks the fastest rate at or below these. */
+#define SD_DEFAULT_SPEED_BAUD_RATE (25 * 1000 * 1000)
+#define SD_HIGH_SPEED_BAUD_RATE (50 * 1000 * 1000)
+
+/* CMD6 argument: function group 1 (access mode) = 1 (high speed), other
+ * groups 0xF (no change). Bit 31 selects switch rather than check mode. */
+#define CMD6_HIGH_SPEED_CHECK (0x00FFFFF1)
+#define CMD6_HIGH_SPEED_SWITCH (0x80FFFFF1)
+
+/* Issue CMD6 and read back its 512-bit switch status. Byte 13 bit 1 is
+ * "function group 1 supports high speed" (status bit 401) and the low nibble
+ * of byte 16 is the function group 1 selects (bits 379:376). */
+static bool sd_switch_func(sd_card_t *pSD, uint32_t arg, uint8_t status[64]) {
+    if (SD_BLOCK_DEVICE_ERROR_NONE != sd_cmd(pSD, CMD6_SWITCH_FUNC, arg, false, 0))
+        return false;
+    return 0 == sd_read_bytes(pSD, status, 64);
+}
+
+static bool sd_switch_high_speed(sd_card_t *pSD) {
+    uint8_t status[64];
+
+    // Version 1.0 cards and cards without command class 10 reject CMD6
+    if (!sd_switch_func(pSD, CMD6_HIGH_SPEED_CHECK, status))
+        return false;
+    if (!(status[13] & 0x02) || 1 != (status[16] & 0x0F))
+        return false;
+    if (!sd_switch_func(pSD, CMD6_HIGH_SPEED_SWITCH, status))
+        return false;
+    // The card takes at most 8 clocks to change timing after the status block
+    sd_spi_write(pSD, SPI_FILL_CHAR);
+    return 1 == (status[16] & 0x0F);
+}
+
+/*!< Reads of the boot sector used to prove a clock rate before trusting it */
+#define SD_CLOCK_PROBE_READS 4
+
+/* Read the boot sector a few times with CRC checking on and step the clock
+ * down until that comes back clean. Ordinary transfers keep the same fallback,
+ * so this just moves the first few failures out of the user's way. */
+static void sd_settle_frequency(sd_card_t *pSD) {
+    static uint8_t probe[BLOCK_SIZE_HC];
+    uint64_t addr = 0;
+    int i = 0;
+    while (i < SD_CLOCK_PROBE_READS) {
+        int status = sd_cmd(pSD, CMD17_READ_SINGLE_BLOCK, addr, false, 0);
+        if (SD_BLOCK_DEVICE_ERROR_NONE == status)
+            status = sd_read_block(pSD, probe, _block_size);
+        if (SD_BLOCK_DEVICE_ERROR_NONE == status) {
+            ++i;
+        } else if (sd_spi_step_down_frequency(pSD)) {
+            i = 0;
+        } else {
+            break;
+        }
+    }
+    DBG_PRINTF("SD clock settled at %lu Hz\r\n", (long)pSD->baud_rate);
+}
+
 static int sd_init_medium(sd_card_t *pSD) {
     int32_t status = SD_BLOCK_DEVICE_ERROR_NONE;
     uint32_t response, arg;
@@ -1137,6 +1267,8 @@ static void sd_ctor(sd_card_t *pSD) {
     pSD->init = sd_init;
     pSD->write_blocks = sd_write_blocks;
     pSD->read_blocks = sd_read_blocks;
+    pSD->sync = sd_sync;
+    pSD->wr_session_open = false;
     pSD->sd_test_com = sd_test_com;
 }
 bool sd_init_driver() {
@@ -1199,6 +1331,7 @@ static int sd_init(sd_card_t *pSD) {
     }
     // Initialize the member variables
     pSD->card_type = SDCARD_NONE;
+    pSD->wr_session_open = false;
 
     sd_spi_acquire(pSD);
 
@@ -1224,8 +1357,14 @@ static int sd_init(sd_card_t *pSD) {
         sd_unlock(pSD);
         return pSD->m_Status;
     }
-    // Set SCK for data transfer
+    // Start SCK for data transfer at the fastest rate both the card and the
+    // configured SPI limit allow, then back off until transfers are clean
+    pSD->baud_rate = sd_switch_high_speed(pSD) ? SD_HIGH_SPEED_BAUD_RATE
+                                               : SD_DEFAULT_SPEED_BAUD_RATE;
+    if (pSD->baud_rate > pSD->spi->baud_rate)
+        pSD->baud_rate = pSD->spi->baud_rate;
     sd_spi_go_high_frequency(pSD);
+    sd_settle_frequency(pSD);
 
     // The card is now initialized
     pSD->m_Status &= ~STA_NOINIT;
@@ -1247,6 +1386,7 @@ static bool sd_test_com(sd_card_t *pSD) {
 
     if (!(pSD->m_Status & STA_NOINIT)) {
         // SD card is currently initialized
+        sd_stop_write_session(pSD);
 
         // Timeout of 0 means only check once
         if (sd_wait_ready(pSD, 0)) {
@@ -51,15 +51,22 @@ struct sd_card_t {
     int m_Status;                                    // Card status
     uint64_t sectors;                                // Assigned dynamically
     int card_type;                                   // Assigned dynamically
+    uint baud_rate;                                  // SPI rate settled on after CRC fallback
     mutex_t mutex;
     FATFS fatfs;
     bool mounted;
+    // A CMD25 multi-block write is left open between calls so that writes to
+    // consecutive LBAs stream straight on. Any other command closes it first.
+    bool wr_session_open;
+    uint64_t wr_session_next;                        // LBA the open session expects next
 
     int (*init)(sd_card_t *sd_card_p);
     int (*write_blocks)(sd_card_t *sd_card_p, const uint8_t *buffer,
                     uint64_t ulSectorNumber, uint32_t blockCnt);
     int (*read_blocks)(sd_card_t *sd_card_p, uint8_t *buffer, uint64_t ulSectorNumber,
                     uint32_t ulSectorCount);
+    // Closes any open write session and waits for the card to finish programming
+    int (*sync)(sd_card_t *sd_card_p);
 
     // Useful when use_card_detect is false - call periodically to check for presence of SD card
     // Returns true if and only if SD card was sensed on the bus
@@ -89,6 +96,7 @@ struct sd_card_t {
 
 bool sd_card_detect(sd_card_t *pSD);
 uint64_t sd_sectors(sd_card_t *pSD);
+int sd_sync(sd_card_t *pSD);
 
 bool sd_init_driver();
 bool sd_card_detect(sd_card_t *sd_card_p);
@@ -30,10 +30,22 @@ specific language governing permissions and limitations under the License.
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wunused-variable"
 
+// Slowest data rate the adaptive clock falls back to before giving up
+#define SD_SPI_MIN_BAUD_RATE (5 * 1000 * 1000)
+
 void sd_spi_go_high_frequency(sd_card_t *pSD) {
-    uint actual = spi_set_baudrate(pSD->spi->hw_inst, pSD->spi->baud_rate);
+    uint actual = spi_set_baudrate(pSD->spi->hw_inst, pSD->baud_rate);
+    pSD->baud_rate = actual;
     TRACE_PRINTF("%s: Actual frequency: %lu\n", __FUNCTION__, (long)actual);
 }
+bool sd_spi_step_down_frequency(sd_card_t *pSD) {
+    uint current = spi_get_baudrate(pSD->spi->hw_inst);
+    if (current <= SD_SPI_MIN_BAUD_RATE) return false;
+    // Asking for just under the current rate selects the next divider down
+    pSD->baud_rate = spi_set_baudrate(pSD->spi->hw_inst, current - 1);
+    DBG_PRINTF("%s: %lu -> %lu\n", __FUNCTION__, (long)current, (long)pSD->baud_rate);
+    return true;
+}
 void sd_spi_go_low_frequency(sd_card_t *pSD) {
     uint actual = spi_set_baudrate(pSD->spi->hw_inst, 400 * 1000); // Actual frequency: 398089
     TRACE_PRINTF("%s: Actual frequency: %lu\n", __FUNCTION__, (long)actual);
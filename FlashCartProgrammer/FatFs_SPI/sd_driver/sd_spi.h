@@ -27,6 +27,9 @@ void sd_spi_acquire(sd_card_t *pSD);
 void sd_spi_release(sd_card_t *pSD);
 void sd_spi_go_low_frequency(sd_card_t *this);
 void sd_spi_go_high_frequency(sd_card_t *this);
+/* Drop to the next slower rate the SPI divider can produce. Returns false
+once the floor has been reached and there is nothing left to try. */
+bool sd_spi_step_down_frequency(sd_card_t *pSD);
 
 /* 
 After power up, the host starts the clock and sends the initializing sequence on the CMD line. 
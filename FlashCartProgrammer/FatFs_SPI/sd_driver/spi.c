@@ -20,6 +20,7 @@ specific language governing permissions and limitations under the License.
 #include "pico/sem.h"
 //
 #include "my_debug.h"
+#include "event_trace.h"
 #include "hw_config.h"
 //
 #include "spi.h"
@@ -64,6 +65,8 @@ bool spi_transfer(spi_t *spi_p, const uint8_t *tx, uint8_t *rx, size_t length) {
     assert(tx || rx);
     // assert(!(tx && rx));
 
+    EVENT_TRACE(EVENT_SPI_TRANSFER_BEGIN, length);
+
     // tx write increment is already false
     if (tx) {
         channel_config_set_read_increment(&spi_p->tx_dma_cfg, true);
@@ -118,6 +121,7 @@ bool spi_transfer(spi_t *spi_p, const uint8_t *tx, uint8_t *rx, size_t length) {
     if (!rc) {
         // If the timeout is reached the function will return false
         DBG_PRINTF("Notification wait timed out in %s\n", __FUNCTION__);
+        EVENT_TRACE(EVENT_SPI_TRANSFER_END, 0);
         return false;
     }
     // Shouldn't be necessary:
@@ -128,6 +132,7 @@ bool spi_transfer(spi_t *spi_p, const uint8_t *tx, uint8_t *rx, size_t length) {
     assert(!dma_channel_is_busy(spi_p->tx_dma));
     assert(!dma_channel_is_busy(spi_p->rx_dma));
 
+    EVENT_TRACE(EVENT_SPI_TRANSFER_END, 1);
     return true;
 }
 
@@ -0,0 +1,106 @@
+//------------------------------------------------------------------------------------------------
+//---- event_trace.c - Core 0 timestamped event ring                                          ----
+//------------------------------------------------------------------------------------------------
+//---- Only core 0 records, but the dump keeps a per-core slot so core 1 can be added later.  ----
+//------------------------------------------------------------------------------------------------
+#include <string.h>
+//
+#include "hardware/clocks.h"
+//
+#include "ff_extent.h"
+//
+#include "event_trace.h"
+
+#define EVENT_TRACE_MAGIC		(0x52545645)		// "EVTR"
+#define EVENT_TRACE_VERSION		(1)
+#define EVENT_TRACE_HEADER_SIZE	(FF_MAX_SS)
+
+#if EVENT_TRACE_ENABLED
+
+EVENT_TRACE_RING event_trace_ring[EVENT_TRACE_CORES] __attribute__((aligned(4)));
+volatile bool event_trace_enabled = false;
+
+typedef struct
+{
+	uint32_t	magic;
+	uint16_t	version;
+	uint16_t	cores;
+	uint32_t	entries;			// Per core
+	uint32_t	clock_hz;			// clk_sys, the rate the cycle counters run at
+	uint32_t	head[EVENT_TRACE_CORES];
+} EVENT_TRACE_HEADER;
+
+//------------------------------------------------------------------------------------------------
+//---- event_trace_init                                                                       ----
+//------------------------------------------------------------------------------------------------
+void event_trace_init(void)
+{
+	if (sio_hw->cpuid >= EVENT_TRACE_CORES)
+		return;
+
+	event_trace_ring[sio_hw->cpuid].head = 0;
+
+	m33_hw->demcr |= M33_DEMCR_TRCENA_BITS;
+	m33_hw->dwt_cyccnt = 0;
+	m33_hw->dwt_ctrl |= M33_DWT_CTRL_CYCCNTENA_BITS;
+
+	event_trace_enabled = true;
+}
+
+//------------------------------------------------------------------------------------------------
+//---- event_trace_dump                                                                       ----
+//------------------------------------------------------------------------------------------------
+FRESULT event_trace_dump(const TCHAR* pszPath)
+{
+	static uint8_t s_aHeaderSector[EVENT_TRACE_HEADER_SIZE] __attribute__((aligned(4)));
+	static FF_IMAGE s_image;
+
+	const bool bWasEnabled = event_trace_enabled;
+	event_trace_enabled = false;
+
+	EVENT_TRACE_HEADER* pHeader = (EVENT_TRACE_HEADER*)s_aHeaderSector;
+	memset(s_aHeaderSector, 0, sizeof(s_aHeaderSector));
+	pHeader->magic = EVENT_TRACE_MAGIC;
+	pHeader->version = EVENT_TRACE_VERSION;
+	pHeader->cores = EVENT_TRACE_CORES;
+	pHeader->entries = EVENT_TRACE_ENTRIES;
+	pHeader->clock_hz = clock_get_hz(clk_sys);
+
+	for (uint i=0; i<EVENT_TRACE_CORES; ++i)
+		pHeader->head[i] = event_trace_ring[i].head;
+
+	const UINT uRingBytes = sizeof(EVENT_TRACE_ENTRY) * EVENT_TRACE_ENTRIES;
+	const FSIZE_t uFileSize = EVENT_TRACE_HEADER_SIZE + ((FSIZE_t)uRingBytes * EVENT_TRACE_CORES);
+
+	FRESULT fr = ff_image_create(&s_image, pszPath, uFileSize);
+	if (FR_OK == fr)
+	{
+		UINT uWritten;
+		fr = ff_image_write(&s_image, s_aHeaderSector, 0, EVENT_TRACE_HEADER_SIZE, &uWritten);
+
+		// The rings go out straight from RAM, the decoder unrolls them using the heads.
+		for (uint i=0; (FR_OK == fr) && (i < EVENT_TRACE_CORES); ++i)
+			fr = ff_image_write(&s_image, event_trace_ring[i].entry, EVENT_TRACE_HEADER_SIZE + ((FSIZE_t)uRingBytes * i), uRingBytes, &uWritten);
+
+		const FRESULT frClose = ff_image_close(&s_image);
+		if (FR_OK == fr)
+			fr = frClose;
+	}
+
+	event_trace_enabled = bWasEnabled;
+	return fr;
+}
+
+#else
+
+void event_trace_init(void)
+{
+}
+
+FRESULT event_trace_dump(const TCHAR* pszPath)
+{
+	(void)pszPath;
+	return FR_OK;
+}
+
+#endif
@@ -0,0 +1,242 @@
+//------------------------------------------------------------------------------------------------
+//---- ff_extent.c - Raw LBA extent access to FatFs files                                     ----
+//------------------------------------------------------------------------------------------------
+#include <stdbool.h>
+#include <stddef.h>
+//
+#include "ff.h"
+#include "diskio.h"
+//
+#include "ff_extent.h"
+
+// FF_MIN_SS == FF_MAX_SS in ffconf.h so the sector size is fixed.
+#define FF_IMAGE_SECTOR_SIZE	(FF_MAX_SS)
+
+//------------------------------------------------------------------------------------------------
+//---- ff_cluster_to_sector - Same mapping as FatFs's private clst2sect                      ----
+//------------------------------------------------------------------------------------------------
+static LBA_t ff_cluster_to_sector(const FATFS* pFS, const DWORD uCluster)
+{
+	return pFS->database + (LBA_t)pFS->csize * (uCluster - 2);
+}
+
+//------------------------------------------------------------------------------------------------
+//---- ff_image_add_extent                                                                    ----
+//------------------------------------------------------------------------------------------------
+static bool ff_image_add_extent(FF_IMAGE* pImage, const LBA_t uLBA, const DWORD uSectors)
+{
+	// Fragments that happen to abut on the card are one run as far as the card is concerned.
+	if (pImage->count)
+	{
+		FF_EXTENT* pLast = &pImage->extent[pImage->count - 1];
+		if ((pLast->lba + pLast->sectors) == uLBA)
+		{
+			pLast->sectors += uSectors;
+			return true;
+		}
+	}
+
+	if (pImage->count >= FF_IMAGE_MAX_EXTENTS)
+		return false;
+
+	pImage->extent[pImage->count].lba = uLBA;
+	pImage->extent[pImage->count].sectors = uSectors;
+	pImage->count++;
+	return true;
+}
+
+//------------------------------------------------------------------------------------------------
+//---- ff_image_transfer - Move whole sectors between a buffer and the image's extents        ----
+//------------------------------------------------------------------------------------------------
+static FRESULT ff_image_transfer(FF_IMAGE* pImage, BYTE* pBuffer, const FSIZE_t uOffset, const UINT uLength, const bool bWrite)
+{
+	if (uOffset % FF_IMAGE_SECTOR_SIZE)
+		return FR_INVALID_PARAMETER;
+
+	const BYTE uDrive = pImage->fil.obj.fs->pdrv;
+	FSIZE_t uSector = uOffset / FF_IMAGE_SECTOR_SIZE;
+	DWORD uRemaining = (uLength + FF_IMAGE_SECTOR_SIZE - 1) / FF_IMAGE_SECTOR_SIZE;
+
+	for (UINT i=0; uRemaining && (i < pImage->count); ++i)
+	{
+		const FF_EXTENT* pExtent = &pImage->extent[i];
+
+		if (uSector >= pExtent->sectors)
+		{
+			uSector -= pExtent->sectors;
+			continue;
+		}
+
+		DWORD uRun = pExtent->sectors - (DWORD)uSector;
+		if (uRun > uRemaining)
+			uRun = uRemaining;
+
+		const DRESULT dr = bWrite ? disk_write(uDrive, pBuffer, pExtent->lba + uSector, uRun)
+								  : disk_read(uDrive, pBuffer, pExtent->lba + uSector, uRun);
+		if (RES_OK != dr)
+			return FR_DISK_ERR;
+
+		pBuffer += uRun * FF_IMAGE_SECTOR_SIZE;
+		uRemaining -= uRun;
+		uSector = 0;
+	}
+
+	// The extents cover the whole file, running out means the map is wrong.
+	return uRemaining ? FR_INT_ERR : FR_OK;
+}
+
+//------------------------------------------------------------------------------------------------
+//---- ff_image_open                                                                          ----
+//------------------------------------------------------------------------------------------------
+FRESULT ff_image_open(FF_IMAGE* pImage, const TCHAR* pszPath)
+{
+	pImage->count = 0;
+
+	FRESULT fr = f_open(&pImage->fil, pszPath, FA_OPEN_EXISTING | FA_READ);
+	if (FR_OK != fr)
+		return fr;
+
+	pImage->size = f_size(&pImage->fil);
+	const FATFS* pFS = pImage->fil.obj.fs;
+
+	// Empty files own no clusters.
+	if (0 == pImage->fil.obj.sclust)
+		return FR_OK;
+
+#if FF_FS_EXFAT
+	// exFAT marks files written without a FAT chain, those are contiguous by definition.
+	if (2 == pImage->fil.obj.stat)
+	{
+		const FSIZE_t uClusterBytes = (FSIZE_t)pFS->csize * FF_IMAGE_SECTOR_SIZE;
+		const DWORD uClusters = (DWORD)((pImage->size + uClusterBytes - 1) / uClusterBytes);
+		ff_image_add_extent(pImage, ff_cluster_to_sector(pFS, pImage->fil.obj.sclust), uClusters * pFS->csize);
+		return FR_OK;
+	}
+#endif
+
+	// Let FatFs walk the chain once into a cluster link map table: {size, {length, start}..., 0}
+	DWORD aLinkMap[2 + (FF_IMAGE_MAX_EXTENTS * 2)];
+	aLinkMap[0] = sizeof(aLinkMap) / sizeof(aLinkMap[0]);
+
+	pImage->fil.cltbl = aLinkMap;
+	fr = f_lseek(&pImage->fil, CREATE_LINKMAP);
+	pImage->fil.cltbl = NULL;		// Table lives on this stack frame, f_read must not keep it.
+
+	if (FR_NOT_ENOUGH_CORE == fr)
+		return FR_OK;				// Too fragmented, ff_image_read will fall back to f_read.
+
+	if (FR_OK != fr)
+	{
+		f_close(&pImage->fil);
+		return fr;
+	}
+
+	for (UINT i=1; aLinkMap[i]; i+=2)
+	{
+		if (!ff_image_add_extent(pImage, ff_cluster_to_sector(pFS, aLinkMap[i + 1]), aLinkMap[i] * pFS->csize))
+		{
+			pImage->count = 0;
+			break;
+		}
+	}
+
+	return FR_OK;
+}
+
+//------------------------------------------------------------------------------------------------
+//---- ff_image_create                                                                        ----
+//------------------------------------------------------------------------------------------------
+FRESULT ff_image_create(FF_IMAGE* pImage, const TCHAR* pszPath, FSIZE_t uSize)
+{
+	pImage->count = 0;
+	pImage->size = uSize;
+
+	FRESULT fr = f_open(&pImage->fil, pszPath, FA_CREATE_ALWAYS | FA_WRITE);
+	if ((FR_OK != fr) || (0 == uSize))
+		return fr;
+
+	fr = f_expand(&pImage->fil, uSize, 1);
+
+	if (FR_DENIED == fr)
+		return FR_OK;				// No contiguous space, ff_image_write will fall back to f_write.
+
+	if (FR_OK != fr)
+	{
+		f_close(&pImage->fil);
+		return fr;
+	}
+
+	const FATFS* pFS = pImage->fil.obj.fs;
+	const FSIZE_t uClusterBytes = (FSIZE_t)pFS->csize * FF_IMAGE_SECTOR_SIZE;
+	const DWORD uClusters = (DWORD)((uSize + uClusterBytes - 1) / uClusterBytes);
+	ff_image_add_extent(pImage, ff_cluster_to_sector(pFS, pImage->fil.obj.sclust), uClusters * pFS->csize);
+	return FR_OK;
+}
+
+//------------------------------------------------------------------------------------------------
+//---- ff_image_close                                                                         ----
+//------------------------------------------------------------------------------------------------
+FRESULT ff_image_close(FF_IMAGE* pImage)
+{
+	pImage->count = 0;
+	return f_close(&pImage->fil);
+}
+
+//------------------------------------------------------------------------------------------------
+//---- ff_image_read                                                                          ----
+//------------------------------------------------------------------------------------------------
+FRESULT ff_image_read(FF_IMAGE* pImage, void* pBuffer, FSIZE_t uOffset, UINT uLength, UINT* puRead)
+{
+	*puRead = 0;
+
+	if (uOffset >= pImage->size)
+		return FR_OK;
+
+	if (uLength > (pImage->size - uOffset))
+		uLength = (UINT)(pImage->size - uOffset);
+
+	if (0 == pImage->count)
+	{
+		FRESULT fr = f_lseek(&pImage->fil, uOffset);
+		if (FR_OK != fr)
+			return fr;
+
+		return f_read(&pImage->fil, pBuffer, uLength, puRead);
+	}
+
+	FRESULT fr = ff_image_transfer(pImage, pBuffer, uOffset, uLength, false);
+	if (FR_OK == fr)
+		*puRead = uLength;
+
+	return fr;
+}
+
+//------------------------------------------------------------------------------------------------
+//---- ff_image_write                                                                         ----
+//------------------------------------------------------------------------------------------------
+FRESULT ff_image_write(FF_IMAGE* pImage, const void* pBuffer, FSIZE_t uOffset, UINT uLength, UINT* puWritten)
+{
+	*puWritten = 0;
+
+	if (uOffset >= pImage->size)
+		return FR_OK;
+
+	if (uLength > (pImage->size - uOffset))
+		uLength = (UINT)(pImage->size - uOffset);
+
+	if (0 == pImage->count)
+	{
+		FRESULT fr = f_lseek(&pImage->fil, uOffset);
+		if (FR_OK != fr)
+			return fr;
+
+		return f_write(&pImage->fil, pBuffer, uLength, puWritten);
+	}
+
+	// Consecutive calls continue the SD driver's open CMD25 session.
+	FRESULT fr = ff_image_transfer(pImage, (BYTE*)pBuffer, uOffset, uLength, true);
+	if (FR_OK == fr)
+		*puWritten = uLength;
+
+	return fr;
+}
@@ -25,6 +25,7 @@ specific language governing permissions and limitations under the License.
 //
 #include "diskio.h" /* Declarations of disk functions */
 //
+#include "event_trace.h"
 #include "hw_config.h"
 #include "my_debug.h"
 #include "sd_card.h"
@@ -98,7 +99,9 @@ DRESULT disk_read(BYTE pdrv,  /* Physical drive nmuber to identify the drive */
     TRACE_PRINTF(">>> %s\n", __FUNCTION__);
     sd_card_t *p_sd = sd_get_by_num(pdrv);
     if (!p_sd) return RES_PARERR;
+    EVENT_TRACE(EVENT_DISK_READ_BEGIN, sector);
     int rc = p_sd->read_blocks(p_sd, buff, sector, count);
+    EVENT_TRACE(EVENT_DISK_READ_END, count);
     return sdrc2dresult(rc);
 }
 
@@ -160,8 +163,8 @@ DRESULT disk_ioctl(BYTE pdrv, /* Physical drive nmuber (0..) */
             *(DWORD *)buff = bs;
             return RES_OK;
         }
-        case CTRL_SYNC:
-            return RES_OK;
+        case CTRL_SYNC:  // Complete any pending write process
+            return sdrc2dresult(p_sd->sync(p_sd));
         default:
             return RES_PARERR;
     }
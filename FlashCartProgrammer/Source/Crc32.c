@@ -0,0 +1,67 @@
+//------------------------------------------------------------------------------------------------
+//---- Crc32.c (C) 2026 Dave Gaunt                                                            ----
+//------------------------------------------------------------------------------------------------
+//---- CRC32R on the sniffer with the output reversed and inverted is the zlib CRC. Aligned   ----
+//---- words go through 32 bits at a time, which reversed feed in low byte first the same as  ----
+//---- the bytes would, so only the ends are read a byte at a time.                           ----
+//------------------------------------------------------------------------------------------------
+
+#include "hardware/dma.h"
+
+#include "Crc32.h"
+
+//------------------------------------------------------------------------------------------------
+//---- Crc32_Sniff                                                                            ----
+//------------------------------------------------------------------------------------------------
+static void Crc32_Sniff(const int iChannel, const u8* pData, const u32 uCount, const enum dma_channel_transfer_size eSize)
+{
+	static u32 s_uDiscard;
+
+	if (0 == uCount)
+		return;
+
+	dma_channel_config config = dma_channel_get_default_config(iChannel);
+	channel_config_set_transfer_data_size(&config, eSize);
+	channel_config_set_read_increment(&config, true);
+	channel_config_set_write_increment(&config, false);
+	channel_config_set_sniff_enable(&config, true);
+
+	dma_channel_configure(iChannel, &config, &s_uDiscard, pData, uCount, true);
+	dma_channel_wait_for_finish_blocking(iChannel);
+}
+
+//------------------------------------------------------------------------------------------------
+//---- Crc32                                                                                  ----
+//------------------------------------------------------------------------------------------------
+u32 Crc32(const u32 uCrc, const void* pVoid, const u32 uLength)
+{
+	const u8* pData = (const u8*)pVoid;
+	const int iChannel = dma_claim_unused_channel(true);
+
+	// Bytes Up To The First Word Boundary, Then Words, Then Whatever Is Left
+	u32 uHead = (4 - ((uintptr_t)pData & 3)) & 3;
+	uHead = (uHead < uLength) ? uHead : uLength;
+	const u32 uWords = (uLength - uHead) >> 2;
+	const u32 uTail = uLength - uHead - (uWords << 2);
+
+	// The Accumulator Holds The Register Before The Output Reverse And Invert, So Undo Both To Carry On
+	u32 uSeed = ~uCrc;
+	uSeed = ((uSeed >> 1) & 0x55555555) | ((uSeed & 0x55555555) << 1);
+	uSeed = ((uSeed >> 2) & 0x33333333) | ((uSeed & 0x33333333) << 2);
+	uSeed = ((uSeed >> 4) & 0x0F0F0F0F) | ((uSeed & 0x0F0F0F0F) << 4);
+	uSeed = __builtin_bswap32(uSeed);
+
+	dma_sniffer_enable(iChannel, DMA_SNIFF_CTRL_CALC_VALUE_CRC32R, true);
+	dma_sniffer_set_output_reverse_enabled(true);
+	dma_sniffer_set_output_invert_enabled(true);
+	dma_sniffer_set_data_accumulator(uSeed);
+
+	Crc32_Sniff(iChannel, pData, uHead, DMA_SIZE_8);
+	Crc32_Sniff(iChannel, pData + uHead, uWords, DMA_SIZE_32);
+	Crc32_Sniff(iChannel, pData + uHead + (uWords << 2), uTail, DMA_SIZE_8);
+
+	const u32 uCrc32 = dma_sniffer_get_data_accumulator();
+	dma_sniffer_disable();
+	dma_channel_unclaim(iChannel);
+	return uCrc32;
+}
@@ -0,0 +1,13 @@
+//------------------------------------------------------------------------------------------------
+//---- Crc32.h (C) 2026 Dave Gaunt                                                            ----
+//------------------------------------------------------------------------------------------------
+//---- zlib CRC32 On The DMA Sniffer                                                          ----
+//------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "types.h"
+
+// Carries On From uCrc, 0 To Start, So Crc32(Crc32(0, A), B) Is The CRC Of A Then B.
+// Claims A Free DMA Channel For The Duration, Not For Use From IRQs.
+u32 Crc32(const u32 uCrc, const void* pData, const u32 uLength);
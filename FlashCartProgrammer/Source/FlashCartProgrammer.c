@@ -6,14 +6,22 @@
 //------------------------------------------------------------------------------------------------
 
 #include <stdio.h>
+#include <string.h>
 #include "types.h"
 #include "pico/stdlib.h"
 #include "vga111.h"
+#include "RenderQueue.h"
 
 // See FatFs - Generic FAT Filesystem Module, "Application Interface",
 // http://elm-chan.org/fsw/ff/00index_e.html
 #include "f_util.h"
 #include "ff.h"
+#include "ff_extent.h"
+#include "ImageCache.h"
+#include "RomSparse.h"
+#include "RomTransform.h"
+#include "RomUnpack.h"
+#include "event_trace.h"
 #include "hw_config.h"
 
 enum flash_manufacturer
@@ -29,7 +37,8 @@ enum flash_boot_sector
 	FLASH_SECTOR_NONE = 0,
 	FLASH_SECTOR_4K,
 	FLASH_SECTOR_64K_TOP_BOOT,
-	FLASH_SECTOR_64K_BOTTOM_BOOT
+	FLASH_SECTOR_64K_BOTTOM_BOOT,
+	FLASH_SECTOR_REGIONS							// Erase Block Regions Read From CFI
 };
 
 enum flash_voltage
@@ -38,8 +47,74 @@ enum flash_voltage
 	FLASH_VOLTAGE_5V0 = 0x50
 };
 
+enum flash_algorithm
+{
+	FLASH_ALGORITHM_UNLOCK_BYPASS		= 0x01,		// Two Cycle Program Once Bypass Is Entered
+	FLASH_ALGORITHM_MULTI_SECTOR_ERASE	= 0x02,		// Several Sector Addresses Per Erase Command
+	FLASH_ALGORITHM_ERASE_SUSPEND		= 0x04,		// Erase Can Be Paused To Read Or Program
+	FLASH_ALGORITHM_DQ5_TIMEOUT			= 0x08		// DQ5 Goes High When An Operation Has Failed
+};
+
+enum flash_status
+{
+	FLASH_STATUS_OK = 0,
+	FLASH_STATUS_TIMEOUT,							// Still Busy After The Rated Maximum Time
+	FLASH_STATUS_EXCEEDED							// Chip Flagged Its Own Timeout On DQ5
+};
+
+typedef struct
+{
+	const char*	m_pszName;
+	u8		m_eManufacturer;
+	u8		m_eBootSector;
+	u16		m_uDeviceId;					// Word At Address 1 For 16 Bit Parts, Byte Otherwise
+
+	u8		m_eVoltage;
+	u8		m_u16Bit;
+	u8		m_uSoftwareIdExit;
+	u8		m_uNumSectors;					// 4K Sectors For FLASH_SECTOR_4K, Else 64K
+
+	u8		m_uAlgorithms;					// flash_algorithm Flags
+	u16		m_uProgramTypicalUs;			// Per Byte Or Word
+	u16		m_uProgramMaxUs;
+	u16		m_uSectorEraseTypicalMs;		// Largest Sector
+	u16		m_uSectorEraseMaxMs;
+
+	u32		m_uChipEraseTypicalMs;
+	u32		m_uChipEraseMaxMs;
+} flashChip;
+
+// Name, Manufacturer, Sector Map, Device ID, Voltage, 16 Bit, Software ID Exit, Sectors, Algorithms,
+// Then Typical / Max Program Us, Sector Erase Ms And Chip Erase Ms From The Datasheets.
+// A New Part Only Needs A Line Here.
+#define FLASH_ALGORITHMS_M29F	(FLASH_ALGORITHM_UNLOCK_BYPASS | FLASH_ALGORITHM_MULTI_SECTOR_ERASE | FLASH_ALGORITHM_ERASE_SUSPEND | FLASH_ALGORITHM_DQ5_TIMEOUT)
+#define FLASH_ALGORITHMS_MX29F	(FLASH_ALGORITHM_MULTI_SECTOR_ERASE | FLASH_ALGORITHM_ERASE_SUSPEND | FLASH_ALGORITHM_DQ5_TIMEOUT)
+
+static const flashChip s_aFlashChips[] =
+{
+	{ "M29F200FT",    FLASH_MANUFACTURER_MICRON,    FLASH_SECTOR_64K_TOP_BOOT,     0x2251,  FLASH_VOLTAGE_5V0,  true,   true,   4,    FLASH_ALGORITHMS_M29F,   10,  200,  800,  6000,   3000,   24000 },
+	{ "M29F400FT",    FLASH_MANUFACTURER_MICRON,    FLASH_SECTOR_64K_TOP_BOOT,     0x2223,  FLASH_VOLTAGE_5V0,  true,   true,   8,    FLASH_ALGORITHMS_M29F,   10,  200,  800,  6000,   5000,   48000 },
+	{ "M29F800FT",    FLASH_MANUFACTURER_MICRON,    FLASH_SECTOR_64K_TOP_BOOT,     0x22D6,  FLASH_VOLTAGE_5V0,  true,   true,   16,   FLASH_ALGORITHMS_M29F,   10,  200,  800,  6000,   10000,  96000 },
+	{ "M29F160FT",    FLASH_MANUFACTURER_MICRON,    FLASH_SECTOR_64K_TOP_BOOT,     0x22D2,  FLASH_VOLTAGE_5V0,  true,   true,   32,   FLASH_ALGORITHMS_M29F,   10,  200,  800,  6000,   20000,  192000 },
+	{ "M29F200FB",    FLASH_MANUFACTURER_MICRON,    FLASH_SECTOR_64K_BOTTOM_BOOT,  0x2257,  FLASH_VOLTAGE_5V0,  true,   true,   4,    FLASH_ALGORITHMS_M29F,   10,  200,  800,  6000,   3000,   24000 },
+	{ "M29F400FB",    FLASH_MANUFACTURER_MICRON,    FLASH_SECTOR_64K_BOTTOM_BOOT,  0x22AB,  FLASH_VOLTAGE_5V0,  true,   true,   8,    FLASH_ALGORITHMS_M29F,   10,  200,  800,  6000,   5000,   48000 },
+	{ "M29F800FB",    FLASH_MANUFACTURER_MICRON,    FLASH_SECTOR_64K_BOTTOM_BOOT,  0x2258,  FLASH_VOLTAGE_5V0,  true,   true,   16,   FLASH_ALGORITHMS_M29F,   10,  200,  800,  6000,   10000,  96000 },
+	{ "M29F160FB",    FLASH_MANUFACTURER_MICRON,    FLASH_SECTOR_64K_BOTTOM_BOOT,  0x22D8,  FLASH_VOLTAGE_5V0,  true,   true,   32,   FLASH_ALGORITHMS_M29F,   10,  200,  800,  6000,   20000,  192000 },
+	{ "MX29F200CT",   FLASH_MANUFACTURER_MACRONIX,  FLASH_SECTOR_64K_TOP_BOOT,     0x2251,  FLASH_VOLTAGE_5V0,  true,   false,  4,    FLASH_ALGORITHMS_MX29F,  11,  300,  700,  15000,  4000,   32000 },
+	{ "MX29F200CB",   FLASH_MANUFACTURER_MACRONIX,  FLASH_SECTOR_64K_BOTTOM_BOOT,  0x2257,  FLASH_VOLTAGE_5V0,  true,   false,  4,    FLASH_ALGORITHMS_MX29F,  11,  300,  700,  15000,  4000,   32000 },
+	{ "SST39SF512",   FLASH_MANUFACTURER_SST,       FLASH_SECTOR_4K,               0xB4,    FLASH_VOLTAGE_5V0,  false,  true,   16,   0,                       14,  20,   18,   25,     70,     100 },
+	{ "SST39SF010A",  FLASH_MANUFACTURER_SST,       FLASH_SECTOR_4K,               0xB5,    FLASH_VOLTAGE_5V0,  false,  true,   32,   0,                       14,  20,   18,   25,     70,     100 },
+	{ "SST39SF020A",  FLASH_MANUFACTURER_SST,       FLASH_SECTOR_4K,               0xB6,    FLASH_VOLTAGE_5V0,  false,  true,   64,   0,                       14,  20,   18,   25,     70,     100 },
+	{ "SST39SF040",   FLASH_MANUFACTURER_SST,       FLASH_SECTOR_4K,               0xB7,    FLASH_VOLTAGE_5V0,  false,  true,   128,  0,                       14,  20,   18,   25,     70,     100 },
+	{ "SST39VF512",   FLASH_MANUFACTURER_SST,       FLASH_SECTOR_4K,               0xD4,    FLASH_VOLTAGE_3V3,  false,  true,   16,   0,                       14,  20,   18,   25,     40,     100 },
+	{ "SST39VF010",   FLASH_MANUFACTURER_SST,       FLASH_SECTOR_4K,               0xD5,    FLASH_VOLTAGE_3V3,  false,  true,   32,   0,                       14,  20,   18,   25,     40,     100 },
+	{ "SST39VF020",   FLASH_MANUFACTURER_SST,       FLASH_SECTOR_4K,               0xD6,    FLASH_VOLTAGE_3V3,  false,  true,   64,   0,                       14,  20,   18,   25,     40,     100 },
+	{ "SST39VF040",   FLASH_MANUFACTURER_SST,       FLASH_SECTOR_4K,               0xD7,    FLASH_VOLTAGE_3V3,  false,  true,   128,  0,                       14,  20,   18,   25,     40,     100 }
+};
+
 typedef struct 
 {
+	const flashChip*	m_pChip;			// NULL When Guessing At A Mask ROM
 	u8		m_bInitialised;
 	u8		m_eManufacturer;
 	u8		m_eVoltage;
@@ -47,8 +122,7 @@ typedef struct
 
 	u8		m_u16Bit;
 	u8		m_uSoftwareIdExit;
-	u8		m_uPadding;
-	u8		m_uNumSectors;
+	u16		m_uNumSectors;
 
 	u32		m_uSize;
 } flashROM;
@@ -71,53 +145,54 @@ enum mcu_pins
 };
 
 #define ADDRESS_BUS_SIZE		(20)
-
-static volatile u8 s_aReadBuffer[1024];
+#define FLASH_BLOCK_SIZE		(1024)			// Verify / Program Granularity
+#define FLASH_READ_CYCLES		(15)			// tRC Of 70ns At 150MHz, Plus The Level Shifters
+#define FLASH_ERASE_BATCH		(16)			// Sectors Per Multi Sector Erase Command
+#define FLASH_MAX_REGIONS		(4)				// CFI Erase Block Regions
+#define FLASH_ERASE_MIN_RUN_US	(500)			// Erase Time Between A Resume And The Next Suspend
+#define FLASH_SUSPEND_MAX_US	(50)			// Erase Suspend Latency
+#define SD_READ_BUFFER_SIZE		(8192)			// Multiple Of The SD Sector Size
+#ifndef FLASHCART_PRODUCTION_LINE
+#define FLASHCART_PRODUCTION_LINE	(0)		// 1 - Program Every Cart Inserted Without Rebooting
+#endif
+
+#define PRODUCTION_IMAGE		"VicDiagROM.a0"
+#define PRODUCTION_POLL_MS		(50)
+#define PRODUCTION_DEBOUNCE		(3)				// Polls That Must Agree Before Insert Or Removal Counts
+#define PROGRESS_CHAR_X			(2)				// Job Progress Bar, In Character Cells
+#define PROGRESS_CHAR_Y			(5)
+#define PROGRESS_WIDTH			(76)
+
+static volatile u8 s_aReadBuffer[SD_READ_BUFFER_SIZE] __attribute__((aligned(4)));
+static u8 s_aUnpackBuffer[FLASH_BLOCK_SIZE] __attribute__((aligned(4)));
+static RomUnpack s_romUnpack;
+static RomSparseExtent s_aSparseExtents[ROM_SPARSE_MAX_EXTENTS];
 static flashROM s_flashROM = {0};
 
-//------------------------------------------------------------------------------------------------
-//---- ascii_to_petscii                                                                       ----
-//------------------------------------------------------------------------------------------------
-u8 ascii_to_petscii(const u8 c)
+typedef struct
 {
-    // Handle ASCII Lowercase (97-122) Maps 'a'-'z' to ROM Lowwercase (1-26)
-    if (c >= 97 && c <= 122)
-		return c - 96;
-
-    // Special Case For '@'
-    if (c == 64)
-		return 0;
-
-    // Handle Space (32) through 'Z' (90)
-	// This includes numbers and maps ASCII Uppercase (65-90) to ROM Uppercase (65-90)
-    if (c >= 32 && c <= 90)
-		return c;
-
-    // Default to Space
-    return 32; 
-}
-
-//------------------------------------------------------------------------------------------------
-//---- FormatHexDumpLine	                                                                  ----
-//------------------------------------------------------------------------------------------------
-void FormatHexDumpLine(u32 uCharX, u32 uCharY, const u32 uAddress, const u8* pLineBuffer, const u8 uColour, const bool bASCII)
+	u32		m_uProgramTypicalUs;
+	u32		m_uProgramMaxUs;
+	u32		m_uEraseTypicalUs;				// Per Sector
+	u32		m_uEraseMaxUs;
+	u32		m_uChipEraseTypicalUs;
+	u32		m_uChipEraseMaxUs;
+	bool	m_bCheckDQ5;
+} flashTiming;
+
+// Until A Chip Is Identified, Generous Enough For Any Part This Programmer Takes
+static flashTiming s_flashTiming = { 10, 1000, 100000, 10000000, 1000000, 200000000, false };
+
+typedef struct
 {
-	// Write Address Offset in 6 byte hex.
-	for(int i=5; i>=0; --i)
-		vga_DrawPetsciiChar((uCharX + 5 - i) << 3, uCharY << 3, g_aHexTable[(uAddress >> (i << 2)) & 15], uColour);
+	u8		m_eStatus;
+	u32		m_uAddress;						// Bus Address Of The Failed Operation
+} flashStatus;
 
-	// Write 16 bytes worth of hex values.
- 	for(u32 uIndex=0; uIndex<16; ++uIndex)
-	{
-    	const u16 uHexPair = byteToHex(pLineBuffer[uIndex]);
-		vga_DrawPetsciiChar((uCharX + 8 + (uIndex * 3)) << 3, uCharY << 3, uHexPair >> 8, uColour);
-		vga_DrawPetsciiChar((uCharX + 9 + (uIndex * 3)) << 3, uCharY << 3, uHexPair & 255, uColour);
+static flashStatus s_flashStatus = { FLASH_STATUS_OK, 0 };
 
-		// Write ASCII or PETSCII version of byte.
-		const u8 uCurrentChar = (bASCII) ? ascii_to_petscii(pLineBuffer[uIndex]) : pLineBuffer[uIndex];
-		vga_DrawPetsciiChar((uCharX + 57 + uIndex) << 3, uCharY << 3, uCurrentChar, uColour);
-	}
-}
+// Indexed By flash_status, A Failure With No Program Or Erase Error Is A Verify Mismatch
+static const char* const s_apszFlashStatus[] = { "Verify", "Timeout", "DQ5" };
 
 //------------------------------------------------------------------------------------------------
 //---- flash_latch_address                                                                    ----
@@ -184,6 +259,7 @@ void flash_command_sequence(const u32 uAddress, const u8 uData)
 	flash_command_byte(0x5555, 0xAA);
 	flash_command_byte(0x2AAA, 0x55);
 	flash_command_byte(uAddress, uData);
+	EVENT_TRACE_DETAIL(EVENT_FLASH_COMMAND, uData);
 }
 
 //------------------------------------------------------------------------------------------------
@@ -194,7 +270,7 @@ u8 flash_read_byte(const u32 uAddress)
 	flash_latch_address(uAddress);
 	gpio_set_dir_in_masked(((1 << 16) - 1) << PIN_IO0);
 	gpio_put(PIN_DATA_OE, true);
-	busy_wait_at_least_cycles(15);
+	busy_wait_at_least_cycles(FLASH_READ_CYCLES);
 	return (gpio_get_all() >> PIN_IO0) & 0xFF;
 }
 
@@ -206,40 +282,159 @@ u16 flash_read_word(const u32 uAddress)
 	flash_latch_address(uAddress);
 	gpio_set_dir_in_masked(((1 << 16) - 1) << PIN_IO0);
 	gpio_put(PIN_DATA_OE, true);
-	busy_wait_at_least_cycles(15);
-	return swap_u16(gpio_get_all() >> PIN_IO0);
+	busy_wait_at_least_cycles(FLASH_READ_CYCLES);
+	return (u16)(gpio_get_all() >> PIN_IO0);
+}
+
+//------------------------------------------------------------------------------------------------
+//---- flash_read_status - One OE cycle, DQ6 toggles on each while the chip is busy           ----
+//------------------------------------------------------------------------------------------------
+u8 flash_read_status(void)
+{
+	// A Whole Read Cycle Each Side, A Chip That Misses The Edge Doesn't Toggle DQ6 And Looks Ready
+	gpio_put(PIN_FLASH_OE, true);
+	busy_wait_at_least_cycles(FLASH_READ_CYCLES);
+	gpio_put(PIN_FLASH_OE, false);
+	busy_wait_at_least_cycles(FLASH_READ_CYCLES);
+	return (gpio_get_all() >> PIN_IO0) & 0xFF;
+}
+
+//------------------------------------------------------------------------------------------------
+//---- flash_wait_ready - Wait for a program or erase to finish, false if it failed           ----
+//------------------------------------------------------------------------------------------------
+//---- NOTE:  Nothing Can Finish Much Before The Typical Time, So Most Of That Is Slept (Or   ----
+//----        Spun For A Program), Then DQ6 Is Polled Until It Stops Toggling, Sleeping       ----
+//----        uPollUs Between Polls If Non Zero. A Chip Still Busy After uMaxUs, Or One That  ----
+//----        Raises DQ5, Is Reset Back To Read Mode And The Address Recorded.                ----
+//------------------------------------------------------------------------------------------------
+bool flash_wait_ready(const u32 uAddress, const u32 uTypicalUs, const u32 uMaxUs, const u32 uPollUs)
+{
+	const u64 uStartUs = time_us_64();
+	const bool bLong = (0 != uPollUs);
+	const u32 uHeadStartUs = uTypicalUs - (uTypicalUs >> 2);
+
+	flash_command_mode_read();
+	gpio_set_dir_in_masked(((1 << 16) - 1) << PIN_IO0);
+
+	if (bLong)
+		sleep_us(uHeadStartUs);
+	else
+		busy_wait_us_32(uHeadStartUs);
+
+	while (true)
+	{
+		const u8 uFirst = flash_read_status();
+		const u8 uSecond = flash_read_status();
+
+		if (0 == ((uFirst ^ uSecond) & 0x40))
+			return true;
+
+		u8 eStatus = FLASH_STATUS_OK;
+
+		if (s_flashTiming.m_bCheckDQ5 && (uSecond & 0x20))
+		{
+			// DQ5 Can Rise As The Operation Completes, So Only A Fail If DQ6 Still Toggles
+			if (0 == ((flash_read_status() ^ flash_read_status()) & 0x40))
+				return true;
+
+			eStatus = FLASH_STATUS_EXCEEDED;
+		}
+		else if ((time_us_64() - uStartUs) > uMaxUs)
+		{
+			eStatus = FLASH_STATUS_TIMEOUT;
+		}
+
+		if (FLASH_STATUS_OK != eStatus)
+		{
+			s_flashStatus.m_eStatus = eStatus;
+			s_flashStatus.m_uAddress = uAddress;
+			EVENT_TRACE(EVENT_FLASH_FAIL, uAddress);
+
+			flash_command_mode_write();
+			flash_command_byte(0, 0xF0);
+			flash_command_mode_read();
+			return false;
+		}
+
+		if (bLong)
+			sleep_us(uPollUs);
+	}
 }
 
 //------------------------------------------------------------------------------------------------
 //---- flash_write_byte                                                                       ----
 //------------------------------------------------------------------------------------------------
-void flash_write_byte(const u32 uAddress, const u8 uData)
+bool flash_write_byte(const u32 uAddress, const u8 uData)
 {
+	EVENT_TRACE_DETAIL(EVENT_FLASH_PROGRAM_BEGIN, uAddress);
 	flash_command_mode_write();
 	flash_command_sequence(0x5555, 0xA0);
 	flash_command_word(uAddress, uData);
-	flash_command_mode_read();
-	gpio_set_dir_in_masked(((1 << 16) - 1) << PIN_IO0);
-	do
-	{
-		busy_wait_at_least_cycles(9);
-	} while ( ((gpio_get_all() >> PIN_IO0) & 0x80) != (uData & 0x80));
+	const bool bSuccess = flash_wait_ready(uAddress, s_flashTiming.m_uProgramTypicalUs, s_flashTiming.m_uProgramMaxUs, 0);
+	EVENT_TRACE_DETAIL(EVENT_FLASH_PROGRAM_END, uAddress);
+	return bSuccess;
 }
 
 //------------------------------------------------------------------------------------------------
 //---- flash_write_word                                                                       ----
 //------------------------------------------------------------------------------------------------
-void flash_write_word(const u32 uAddress, const u16 uData)
+bool flash_write_word(const u32 uAddress, const u16 uData)
 {
+	EVENT_TRACE_DETAIL(EVENT_FLASH_PROGRAM_BEGIN, uAddress);
 	flash_command_mode_write();
 	flash_command_sequence(0x5555, 0xA0);
 	flash_command_word(uAddress, uData);
+	const bool bSuccess = flash_wait_ready(uAddress, s_flashTiming.m_uProgramTypicalUs, s_flashTiming.m_uProgramMaxUs, 0);
+	EVENT_TRACE_DETAIL(EVENT_FLASH_PROGRAM_END, uAddress);
+	return bSuccess;
+}
+
+//------------------------------------------------------------------------------------------------
+//---- flash_unlock_bypass_entry                                                              ----
+//------------------------------------------------------------------------------------------------
+void flash_unlock_bypass_entry(void)
+{
+	flash_command_mode_write();
+	flash_command_sequence(0x5555, 0x20);
+}
+
+//------------------------------------------------------------------------------------------------
+//---- flash_unlock_bypass_exit                                                               ----
+//------------------------------------------------------------------------------------------------
+void flash_unlock_bypass_exit(void)
+{
+	flash_command_mode_write();
+	flash_command_byte(0, 0x90);
+	flash_command_byte(0, 0x00);
 	flash_command_mode_read();
-	gpio_set_dir_in_masked(((1 << 16) - 1) << PIN_IO0);
-	do
-	{
-		busy_wait_at_least_cycles(9);
-	} while ( ((gpio_get_all() >> PIN_IO0) & 0x80) != (uData & 0x80));
+}
+
+//------------------------------------------------------------------------------------------------
+//---- flash_write_byte_bypass - Program without the unlock cycles, bypass must be entered    ----
+//------------------------------------------------------------------------------------------------
+bool flash_write_byte_bypass(const u32 uAddress, const u8 uData)
+{
+	EVENT_TRACE_DETAIL(EVENT_FLASH_PROGRAM_BEGIN, uAddress);
+	flash_command_mode_write();
+	flash_command_byte(0, 0xA0);
+	flash_command_word(uAddress, uData);
+	const bool bSuccess = flash_wait_ready(uAddress, s_flashTiming.m_uProgramTypicalUs, s_flashTiming.m_uProgramMaxUs, 0);
+	EVENT_TRACE_DETAIL(EVENT_FLASH_PROGRAM_END, uAddress);
+	return bSuccess;
+}
+
+//------------------------------------------------------------------------------------------------
+//---- flash_write_word_bypass - Program without the unlock cycles, bypass must be entered    ----
+//------------------------------------------------------------------------------------------------
+bool flash_write_word_bypass(const u32 uAddress, const u16 uData)
+{
+	EVENT_TRACE_DETAIL(EVENT_FLASH_PROGRAM_BEGIN, uAddress);
+	flash_command_mode_write();
+	flash_command_byte(0, 0xA0);
+	flash_command_word(uAddress, uData);
+	const bool bSuccess = flash_wait_ready(uAddress, s_flashTiming.m_uProgramTypicalUs, s_flashTiming.m_uProgramMaxUs, 0);
+	EVENT_TRACE_DETAIL(EVENT_FLASH_PROGRAM_END, uAddress);
+	return bSuccess;
 }
 
 //------------------------------------------------------------------------------------------------
@@ -285,560 +480,1458 @@ void flash_software_id_exit()
 }
 
 //------------------------------------------------------------------------------------------------
-//---- FlashInitialise                                                                        ----
+//---- Bus Width Specialisations                                                              ----
 //------------------------------------------------------------------------------------------------
-bool FlashInitialise(void)
+//---- NOTE:  One Set Per Bus Width So The Inner Loops Have No Width Test, Picked Once By     ----
+//----        FlashSelectAccess. Addresses And Lengths Are In Bytes, Even For 16 Bit Parts.   ----
+//----        Both Sets Come From FLASH_BUS_FUNCTIONS, uWORD Being The Bus Word Type,         ----
+//----        ACCESS The flash_read_ / flash_write_ Suffix And SHIFT The Byte Address Shift.  ----
+//------------------------------------------------------------------------------------------------
+#define FLASH_BUS_FUNCTIONS(WIDTH, uWORD, ACCESS, SHIFT)												\
+static void FlashRead##WIDTH(void* pData, const u32 uAddress, const u32 uLength)						\
+{																										\
+	assert(0 == ((uAddress | uLength) & ((1 << (SHIFT)) - 1)));											\
+	uWORD* pWordData = (uWORD*)pData;																	\
+	const u32 uWordAddress = uAddress >> (SHIFT);														\
+																										\
+	for (u32 i=0; i<(uLength >> (SHIFT)); ++i)															\
+		pWordData[i] = flash_read_##ACCESS(uWordAddress + i);											\
+}																										\
+																										\
+static bool FlashVerify##WIDTH(const void* pCompareData, const u32 uAddress, const u32 uLength)			\
+{																										\
+	assert(0 == ((uAddress | uLength) & ((1 << (SHIFT)) - 1)));											\
+	const uWORD* pWordData = (const uWORD*)pCompareData;												\
+	const u32 uWordAddress = uAddress >> (SHIFT);														\
+																										\
+	for (u32 i=0; i<(uLength >> (SHIFT)); ++i)															\
+	{																									\
+		if (pWordData[i] != flash_read_##ACCESS(uWordAddress + i))										\
+			return false;																				\
+	}																									\
+																										\
+	return true;																						\
+}																										\
+																										\
+static bool FlashIsErased##WIDTH(const u32 uAddress, const u32 uLength)									\
+{																										\
+	assert(0 == ((uAddress | uLength) & ((1 << (SHIFT)) - 1)));											\
+	const u32 uWordAddress = uAddress >> (SHIFT);														\
+																										\
+	for (u32 i=0; i<(uLength >> (SHIFT)); ++i)															\
+	{																									\
+		if ((uWORD)~0 != flash_read_##ACCESS(uWordAddress + i))											\
+			return false;																				\
+	}																									\
+																										\
+	return true;																						\
+}																										\
+																										\
+static bool FlashProgram##WIDTH(const void* pData, const u32 uAddress, const u32 uLength)				\
+{																										\
+	assert(0 == ((uAddress | uLength) & ((1 << (SHIFT)) - 1)));											\
+	const uWORD* pWordData = (const uWORD*)pData;														\
+	const u32 uWordAddress = uAddress >> (SHIFT);														\
+																										\
+	for (u32 i=0; i<(uLength >> (SHIFT)); ++i)															\
+	{																									\
+		if (!flash_write_##ACCESS(uWordAddress + i, pWordData[i]))										\
+			return false;																				\
+	}																									\
+																										\
+	return true;																						\
+}																										\
+																										\
+static bool FlashProgram##WIDTH##Bypass(const void* pData, const u32 uAddress, const u32 uLength)		\
+{																										\
+	assert(0 == ((uAddress | uLength) & ((1 << (SHIFT)) - 1)));											\
+	const uWORD* pWordData = (const uWORD*)pData;														\
+	const u32 uWordAddress = uAddress >> (SHIFT);														\
+	bool bSuccess = true;																				\
+																										\
+	flash_unlock_bypass_entry();																		\
+																										\
+	for (u32 i=0; bSuccess && (i < (uLength >> (SHIFT))); ++i)											\
+		bSuccess = flash_write_##ACCESS##_bypass(uWordAddress + i, pWordData[i]);						\
+																										\
+	flash_unlock_bypass_exit();																			\
+	return bSuccess;																					\
+}
+
+FLASH_BUS_FUNCTIONS(8,  u8,  byte, 0)
+FLASH_BUS_FUNCTIONS(16, u16, word, 1)
+
+#undef FLASH_BUS_FUNCTIONS
+
+typedef struct
 {
-	if (s_flashROM.m_bInitialised)
-		return false;
+	void	(*m_pfnRead)(void* pData, const u32 uAddress, const u32 uLength);
+	bool	(*m_pfnVerify)(const void* pCompareData, const u32 uAddress, const u32 uLength);
+	bool	(*m_pfnIsErased)(const u32 uAddress, const u32 uLength);
+	bool	(*m_pfnProgram)(const void* pData, const u32 uAddress, const u32 uLength);
+	u32		m_uAddressShift;				// Byte Address To Bus Address
+} flashBus;
+
+// Indexed By 16 Bit | Unlock Bypass << 1
+static const flashBus s_aFlashBus[4] =
+{
+	{ FlashRead8,  FlashVerify8,  FlashIsErased8,  FlashProgram8,        0 },
+	{ FlashRead16, FlashVerify16, FlashIsErased16, FlashProgram16,       1 },
+	{ FlashRead8,  FlashVerify8,  FlashIsErased8,  FlashProgram8Bypass,  0 },
+	{ FlashRead16, FlashVerify16, FlashIsErased16, FlashProgram16Bypass, 1 }
+};
 
-	flash_software_id_entry();
-	sleep_ms(16);				// Give the IC time to exit standby mode.
+//------------------------------------------------------------------------------------------------
+//---- Sector Geometry Specialisations                                                        ----
+//------------------------------------------------------------------------------------------------
+typedef struct
+{
+	u32		m_uOffset;						// Within The 64K Boot Sector
+	u32		m_uLength;
+} flashBootBlock;
+
+// One Entry Per 8K Of The 64K Boot Sector
+static const flashBootBlock s_aTopBoot64k[8] =
+{
+	{ 0,     32768 },		// 32k Block
+	{ 0,     32768 },
+	{ 0,     32768 },
+	{ 0,     32768 },
+	{ 32768, 8192  },		// 8k  Block
+	{ 40960, 8192  },		// 8k  Block
+	{ 49152, 16384 },		// 16k Block
+	{ 49152, 16384 }
+};
+
+static const flashBootBlock s_aBottomBoot64k[8] =
+{
+	{ 0,     16384 },		// 16k Block
+	{ 0,     16384 },
+	{ 16384, 8192  },		// 8k  Block
+	{ 24576, 8192  },		// 8k  Block
+	{ 32768, 32768 },		// 32k Block
+	{ 32768, 32768 },
+	{ 32768, 32768 },
+	{ 32768, 32768 }
+};
+
+static u32 FlashSectorBaseNone(const u32 uAddress)
+{
+	return 0;
+}
+
+static u32 FlashSectorLengthNone(const u32 uAddress)
+{
+	return s_flashROM.m_uSize;
+}
+
+static u32 FlashSectorBase4k(const u32 uAddress)
+{
+	return uAddress & ~4095;
+}
+
+static u32 FlashSectorLength4k(const u32 uAddress)
+{
+	return 4096;
+}
+
+static u32 FlashSectorBaseTopBoot(const u32 uAddress)
+{
+	// Only The Top 64K Is Split Into Boot Blocks
+	if ((uAddress >> 16) < (s_flashROM.m_uNumSectors - 1u))
+		return uAddress & 0xFFFF0000;
+
+	return (uAddress & 0xFFFF0000) + s_aTopBoot64k[(uAddress >> 13) & 7].m_uOffset;
+}
+
+static u32 FlashSectorLengthTopBoot(const u32 uAddress)
+{
+	if ((uAddress >> 16) < (s_flashROM.m_uNumSectors - 1u))
+		return 65536;
+
+	return s_aTopBoot64k[(uAddress >> 13) & 7].m_uLength;
+}
+
+static u32 FlashSectorBaseBottomBoot(const u32 uAddress)
+{
+	// Only The Bottom 64K Is Split Into Boot Blocks
+	if (uAddress >> 16)
+		return uAddress & 0xFFFF0000;
+
+	return s_aBottomBoot64k[(uAddress >> 13) & 7].m_uOffset;
+}
+
+static u32 FlashSectorLengthBottomBoot(const u32 uAddress)
+{
+	if (uAddress >> 16)
+		return 65536;
+
+	return s_aBottomBoot64k[(uAddress >> 13) & 7].m_uLength;
+}
+
+typedef struct
+{
+	u32		m_uBase;
+	u32		m_uSectorLength;
+	u32		m_uNumSectors;
+} flashRegion;
+
+static flashRegion s_aFlashRegions[FLASH_MAX_REGIONS];
+static u32 s_uNumFlashRegions = 0;
 
-	s_flashROM.m_eManufacturer = flash_read_byte(0);
-	switch(s_flashROM.m_eManufacturer)
+static u32 FlashSectorBaseRegions(const u32 uAddress)
+{
+	for (u32 i=0; i<s_uNumFlashRegions; ++i)
 	{
-		case FLASH_MANUFACTURER_MICRON:
-		{
-			const u16 uFlashType = swap_u16(flash_read_word(1));
-			switch (uFlashType)
-			{
-				case 0x2251:	// M29F200FT - 2 Mbit
-				{
-					s_flashROM.m_eBootSector = FLASH_SECTOR_64K_TOP_BOOT;
-					s_flashROM.m_uNumSectors = 4;
-				}
-				break;
-
-				case 0x2223:	// M29F400FT - 4 Mbit
-				{
-					s_flashROM.m_eBootSector = FLASH_SECTOR_64K_TOP_BOOT;
-					s_flashROM.m_uNumSectors = 8;
-				}
-				break;
-
-				case 0x22D6:	// M29F800FT - 8 Mbit
-				{
-					s_flashROM.m_eBootSector = FLASH_SECTOR_64K_TOP_BOOT;
-					s_flashROM.m_uNumSectors = 16;
-				}
-				break;
-
-				case 0x22D2:	// M29F160FT - 16 Mbit
-				{
-					s_flashROM.m_eBootSector = FLASH_SECTOR_64K_TOP_BOOT;
-					s_flashROM.m_uNumSectors = 32;
-				}
-				break;
-
-				case 0x2257:	// M29F200FB - 2 Mbit
-				{
-					s_flashROM.m_eBootSector = FLASH_SECTOR_64K_BOTTOM_BOOT;
-					s_flashROM.m_uNumSectors = 4;
-				}
-				break;
-
-				case 0x22AB:	// M29F400FB - 4 Mbit
-				{
-					s_flashROM.m_eBootSector = FLASH_SECTOR_64K_BOTTOM_BOOT;
-					s_flashROM.m_uNumSectors = 8;
-				}
-				break;
-
-				case 0x2258:	// M29F800FB - 8 Mbit
-				{
-					s_flashROM.m_eBootSector = FLASH_SECTOR_64K_BOTTOM_BOOT;
-					s_flashROM.m_uNumSectors = 16;
-				}
-				break;
-
-				case 0x22D8:	// M29F160FB - 16 Mbit
-				{
-					s_flashROM.m_eBootSector = FLASH_SECTOR_64K_BOTTOM_BOOT;
-					s_flashROM.m_uNumSectors = 32;
-				}
-				break;
-
-				default:
-					return (false);
-			}
+		const flashRegion* pRegion = &s_aFlashRegions[i];
+		const u32 uOffset = uAddress - pRegion->m_uBase;
 
-			s_flashROM.m_uSize = s_flashROM.m_uNumSectors << 16;
-			s_flashROM.m_eVoltage = FLASH_VOLTAGE_5V0;
-			s_flashROM.m_uSoftwareIdExit = true;
-			s_flashROM.m_u16Bit = true;
+		if (uOffset < (pRegion->m_uSectorLength * pRegion->m_uNumSectors))
+			return pRegion->m_uBase + (uOffset - (uOffset % pRegion->m_uSectorLength));
+	}
 
-			s_flashROM.m_bInitialised = true;
-		}
-		break;
+	return 0;
+}
 
-		case FLASH_MANUFACTURER_SST:
-		{
-	 		const u8 uFlashID = flash_read_byte(1);
-			switch (uFlashID >> 4)
-			{
-				case 0xB:
-					s_flashROM.m_eVoltage = FLASH_VOLTAGE_5V0;
-				break;
+static u32 FlashSectorLengthRegions(const u32 uAddress)
+{
+	for (u32 i=0; i<s_uNumFlashRegions; ++i)
+	{
+		const flashRegion* pRegion = &s_aFlashRegions[i];
 
-				case 0xD:
-					s_flashROM.m_eVoltage = FLASH_VOLTAGE_3V3;
-				break;
+		if ((uAddress - pRegion->m_uBase) < (pRegion->m_uSectorLength * pRegion->m_uNumSectors))
+			return pRegion->m_uSectorLength;
+	}
 
-				default:
-					return (false);
-			}
+	return s_flashROM.m_uSize;
+}
 
-			if ( ((uFlashID & 15) < 4) || ((uFlashID & 15) > 7) )
-				return (false);
+typedef struct
+{
+	u32		(*m_pfnGetSectorBase)(const u32 uAddress);
+	u32		(*m_pfnGetSectorLength)(const u32 uAddress);
+} flashGeometry;
 
-			s_flashROM.m_eBootSector = FLASH_SECTOR_4K;
-			const u32 uNumSectors = 1 << (uFlashID & 15);
-			s_flashROM.m_uNumSectors = uNumSectors;
-			s_flashROM.m_uSize = uNumSectors << 12;
+// Indexed By flash_boot_sector
+static const flashGeometry s_aFlashGeometry[5] =
+{
+	{ FlashSectorBaseNone,       FlashSectorLengthNone       },
+	{ FlashSectorBase4k,         FlashSectorLength4k         },
+	{ FlashSectorBaseTopBoot,    FlashSectorLengthTopBoot    },
+	{ FlashSectorBaseBottomBoot, FlashSectorLengthBottomBoot },
+	{ FlashSectorBaseRegions,    FlashSectorLengthRegions    }
+};
 
-			s_flashROM.m_u16Bit = false;
-			s_flashROM.m_uSoftwareIdExit = true;
-			s_flashROM.m_bInitialised = true;
-		}
-		break;
+static const flashBus* s_pFlashBus = &s_aFlashBus[0];
+static const flashGeometry* s_pFlashGeometry = &s_aFlashGeometry[FLASH_SECTOR_NONE];
 
-		case FLASH_MANUFACTURER_MACRONIX:
-		{
-			const u16 uFlashType = swap_u16(flash_read_word(1));
-			switch (uFlashType)
-			{
-				case 0x2251:	// MX29F200CT - 2 Mbit
-				{
-					s_flashROM.m_eBootSector = FLASH_SECTOR_64K_TOP_BOOT;
-					s_flashROM.m_uNumSectors = 4;
-				}					
-				break;
-
-				case 0x2257:	// MX29F200CB - 2 Mbit
-				{
-					s_flashROM.m_eBootSector = FLASH_SECTOR_64K_BOTTOM_BOOT;
-					s_flashROM.m_uNumSectors = 4;
-				}
-				break;
-
-				default:
-					return (false);
-			}
+//------------------------------------------------------------------------------------------------
+//---- FlashHasAlgorithm - True if the identified chip supports all of uAlgorithms            ----
+//------------------------------------------------------------------------------------------------
+static bool FlashHasAlgorithm(const u32 uAlgorithms)
+{
+	return (NULL != s_flashROM.m_pChip) && (uAlgorithms == (s_flashROM.m_pChip->m_uAlgorithms & uAlgorithms));
+}
 
-			s_flashROM.m_uSize = s_flashROM.m_uNumSectors << 16;
-			s_flashROM.m_eVoltage = FLASH_VOLTAGE_5V0;
-			s_flashROM.m_uSoftwareIdExit = false;
-			s_flashROM.m_u16Bit = true;
+//------------------------------------------------------------------------------------------------
+//---- FlashMsToUs - Saturates, a wrapped product would be a tiny timeout                     ----
+//------------------------------------------------------------------------------------------------
+static u32 FlashMsToUs(const u32 uMs)
+{
+	return (uMs < (UINT32_MAX / 1000)) ? (uMs * 1000) : UINT32_MAX;
+}
 
-			s_flashROM.m_bInitialised = true;
-		}
-		break;
+//------------------------------------------------------------------------------------------------
+//---- FlashSelectAccess - Pick the specialisations for the flash in s_flashROM               ----
+//------------------------------------------------------------------------------------------------
+static void FlashSelectAccess(void)
+{
+	assert(s_flashROM.m_eBootSector < (sizeof(s_aFlashGeometry) / sizeof(s_aFlashGeometry[0])));
+	const u32 uBypass = FlashHasAlgorithm(FLASH_ALGORITHM_UNLOCK_BYPASS) ? 2 : 0;
 
-		default:
-			return (false);
+	s_pFlashBus = &s_aFlashBus[(s_flashROM.m_u16Bit ? 1 : 0) | uBypass];
+	s_pFlashGeometry = &s_aFlashGeometry[s_flashROM.m_eBootSector];
+
+	const flashChip* pChip = s_flashROM.m_pChip;
+
+	if (NULL != pChip)
+	{
+		s_flashTiming.m_uProgramTypicalUs = pChip->m_uProgramTypicalUs;
+		s_flashTiming.m_uProgramMaxUs = pChip->m_uProgramMaxUs;
+		s_flashTiming.m_uEraseTypicalUs = FlashMsToUs(pChip->m_uSectorEraseTypicalMs);
+		s_flashTiming.m_uEraseMaxUs = FlashMsToUs(pChip->m_uSectorEraseMaxMs);
+		s_flashTiming.m_uChipEraseTypicalUs = FlashMsToUs(pChip->m_uChipEraseTypicalMs);
+		s_flashTiming.m_uChipEraseMaxUs = FlashMsToUs(pChip->m_uChipEraseMaxMs);
+		s_flashTiming.m_bCheckDQ5 = FlashHasAlgorithm(FLASH_ALGORITHM_DQ5_TIMEOUT);
 	}
+}
+
+//------------------------------------------------------------------------------------------------
+//---- FlashGetStatus - Why the last failed program or erase failed, and where                ----
+//------------------------------------------------------------------------------------------------
+u8 FlashGetStatus(u32* puAddress)
+{
+	if (NULL != puAddress)
+		*puAddress = s_flashStatus.m_uAddress << s_pFlashBus->m_uAddressShift;
+
+	return s_flashStatus.m_eStatus;
+}
+
+//------------------------------------------------------------------------------------------------
+//---- FlashIsCFI - True if the chip is showing its CFI query table                           ----
+//------------------------------------------------------------------------------------------------
+static bool FlashIsCFI(void)
+{
+	// Offsets Are In The Chip's Own Bus Units, So A Byte Read Works In Either Mode
+	return ('Q' == flash_read_byte(0x10)) && ('R' == flash_read_byte(0x11)) && ('Y' == flash_read_byte(0x12));
+}
+
+//------------------------------------------------------------------------------------------------
+//---- FlashReadCFI16 - Little endian 16 bit CFI field                                        ----
+//------------------------------------------------------------------------------------------------
+static u16 FlashReadCFI16(const u32 uOffset)
+{
+	return (u16)(flash_read_byte(uOffset) | (flash_read_byte(uOffset + 1) << 8));
+}
+
+//------------------------------------------------------------------------------------------------
+//---- FlashClampU16 - CFI times can outgrow the u16 fields in flashChip                      ----
+//------------------------------------------------------------------------------------------------
+static u16 FlashClampU16(const u32 uValue)
+{
+	return (u16)((uValue < 0xFFFF) ? uValue : 0xFFFF);
+}
+
+//------------------------------------------------------------------------------------------------
+//---- FlashClampU32 - Chip erase times, 2^31 typical times 2^15 overflows a u32              ----
+//------------------------------------------------------------------------------------------------
+static u32 FlashClampU32(const u64 uValue)
+{
+	return (u32)((uValue < UINT32_MAX) ? uValue : UINT32_MAX);
+}
+
+//------------------------------------------------------------------------------------------------
+//---- FlashExitCFI                                                                           ----
+//------------------------------------------------------------------------------------------------
+static void FlashExitCFI(void)
+{
+	flash_command_mode_write();
+	flash_command_byte(0, 0xF0);
+	flash_command_sequence(0x5555, 0xF0);
+	flash_command_mode_read();
+}
+
+//------------------------------------------------------------------------------------------------
+//---- FlashEnterCFI - Try both query entries, back in read mode if neither works             ----
+//------------------------------------------------------------------------------------------------
+static bool FlashEnterCFI(void)
+{
+	// JEDEC Single Cycle Query, Then The SST Three Cycle Entry
+	flash_command_mode_write();
+	flash_command_byte(0x55, 0x98);
+	flash_command_mode_read();
+
+	if (FlashIsCFI())
+		return true;
+
+	flash_command_mode_write();
+	flash_command_byte(0, 0xF0);
+	flash_command_sequence(0x5555, 0x98);
+	flash_command_mode_read();
+
+	if (FlashIsCFI())
+		return true;
+
+	FlashExitCFI();
+	return false;
+}
+
+//------------------------------------------------------------------------------------------------
+//---- FlashQueryCFI - Describe a part that isn't in s_aFlashChips from its CFI tables        ----
+//------------------------------------------------------------------------------------------------
+//---- NOTE:  Only AMD And SST Command Sets Are Accepted, Everything Else Here Talks In       ----
+//----        Their Unlock Sequences. Regions Are Laid Out From Address 0 Upwards.            ----
+//------------------------------------------------------------------------------------------------
+static flashChip s_flashChipCFI;
+
+static bool FlashQueryCFI(const u8 uManufacturer, const u8 uDeviceId)
+{
+	if (!FlashEnterCFI())
+		return false;
+
+	const u16 uCommandSet = FlashReadCFI16(0x13);
+	const u16 uExtendedTable = FlashReadCFI16(0x15);
+	const u8 uVccMax = flash_read_byte(0x1C);
+	const u8 uProgramTypical = flash_read_byte(0x1F);
+	const u8 uEraseTypical = flash_read_byte(0x21);
+	const u8 uChipTypical = flash_read_byte(0x22);
+	const u8 uProgramMax = flash_read_byte(0x23);
+	const u8 uEraseMax = flash_read_byte(0x25);
+	const u8 uChipMax = flash_read_byte(0x26);
+	const u8 uDeviceSize = flash_read_byte(0x27);
+	const u16 uInterface = FlashReadCFI16(0x28);
+	const u8 uNumRegions = flash_read_byte(0x2C);
+
+	if (((0x0002 != uCommandSet) && (0x0701 != uCommandSet)) || (0 == uNumRegions) || (uNumRegions > FLASH_MAX_REGIONS) || (uDeviceSize > 31))
+	{
+		FlashExitCFI();
+		return false;
+	}
+
+	// x8 Only Parts Are Byte Wide, x16 And x8/x16 Parts Run In Word Mode With BYTE# High
+	const bool b16Bit = (0 != uInterface);
+	const u32 uAddressable = 1u << (ADDRESS_BUS_SIZE + (b16Bit ? 1 : 0));
+	const u32 uSize = ((1u << uDeviceSize) < uAddressable) ? (1u << uDeviceSize) : uAddressable;
+
+	for (u32 i=0; i<uNumRegions; ++i)
+	{
+		const u32 uSectorLength = FlashReadCFI16(0x2F + (i * 4)) << 8;
+
+		s_aFlashRegions[i].m_uNumSectors = FlashReadCFI16(0x2D + (i * 4)) + 1;
+		s_aFlashRegions[i].m_uSectorLength = uSectorLength ? uSectorLength : 128;
+	}
+
+	// AMD Extended Table, Boot Flag Since 1.1. Older Tables Don't Say, So Go By The Device ID As
+	// Linux Does, Top Boot Parts Have Bit 7 Set And Still List Their Regions Bottom Up
+	u8 uEraseSuspend = 0;
+	u8 uBootFlag = 0;
+
+	if ((0x0002 == uCommandSet) && ('P' == flash_read_byte(uExtendedTable)) && ('R' == flash_read_byte(uExtendedTable + 1)) && ('I' == flash_read_byte(uExtendedTable + 2)))
+	{
+		uEraseSuspend = flash_read_byte(uExtendedTable + 6);
+
+		if ((flash_read_byte(uExtendedTable + 3) > '1') || (flash_read_byte(uExtendedTable + 4) >= '1'))
+			uBootFlag = flash_read_byte(uExtendedTable + 0x0F);
+		else
+			uBootFlag = (uDeviceId & 0x80) ? 3 : 2;
+	}
+
+	FlashExitCFI();
+
+	if ((3 == uBootFlag) && (s_aFlashRegions[0].m_uSectorLength < s_aFlashRegions[uNumRegions - 1].m_uSectorLength))
+	{
+		for (u32 i=0; i<(uNumRegions / 2); ++i)
+		{
+			const flashRegion region = s_aFlashRegions[i];
+			s_aFlashRegions[i] = s_aFlashRegions[uNumRegions - 1 - i];
+			s_aFlashRegions[uNumRegions - 1 - i] = region;
+		}
+	}
+
+	// Lay The Regions Out, Dropping Anything Past The End Of The Address Bus
+	u32 uBase = 0;
+	u32 uNumSectors = 0;
+	s_uNumFlashRegions = 0;
+
+	for (u32 i=0; (i < uNumRegions) && (uBase < uSize); ++i)
+	{
+		flashRegion* pRegion = &s_aFlashRegions[i];
+		const u32 uSpace = (uSize - uBase) / pRegion->m_uSectorLength;
+
+		if (pRegion->m_uNumSectors > uSpace)
+			pRegion->m_uNumSectors = uSpace;
+
+		pRegion->m_uBase = uBase;
+		uBase += pRegion->m_uSectorLength * pRegion->m_uNumSectors;
+		uNumSectors += pRegion->m_uNumSectors;
+		++s_uNumFlashRegions;
+	}
+
+	if ((0 == uBase) || (uNumSectors > 0xFFFF))
+		return false;
+
+	flashChip* pChip = &s_flashChipCFI;
+	pChip->m_pszName = "CFI";
+	pChip->m_eManufacturer = uManufacturer;
+	pChip->m_eBootSector = FLASH_SECTOR_REGIONS;
+	pChip->m_uDeviceId = 0;
+	pChip->m_eVoltage = (uVccMax >= 0x45) ? FLASH_VOLTAGE_5V0 : FLASH_VOLTAGE_3V3;
+	pChip->m_u16Bit = b16Bit;
+	pChip->m_uSoftwareIdExit = true;
+	pChip->m_uNumSectors = 0;
+	pChip->m_uAlgorithms = 0;
+
+	if (0x0002 == uCommandSet)
+		pChip->m_uAlgorithms |= FLASH_ALGORITHM_MULTI_SECTOR_ERASE | FLASH_ALGORITHM_DQ5_TIMEOUT;
+
+	if (uEraseSuspend)
+		pChip->m_uAlgorithms |= FLASH_ALGORITHM_ERASE_SUSPEND;
+
+	// CFI Gives 2^N Typical Times And 2^N Times Typical For The Max
+	u32 uLargestSector = 0;
+
+	for (u32 i=0; i<s_uNumFlashRegions; ++i)
+	{
+		if (s_aFlashRegions[i].m_uSectorLength > uLargestSector)
+			uLargestSector = s_aFlashRegions[i].m_uSectorLength;
+	}
+
+	const u32 uEraseTypicalMs = 1u << (uEraseTypical & 15);
+	const u32 uEraseMaxMs = uEraseTypicalMs << (uEraseMax & 15);
+
+	const u32 uProgramTypicalUs = 1u << (uProgramTypical & 15);
+
+	pChip->m_uProgramTypicalUs = FlashClampU16(uProgramTypicalUs);
+	pChip->m_uProgramMaxUs = FlashClampU16(uProgramTypicalUs << (uProgramMax & 15));
+	pChip->m_uSectorEraseTypicalMs = FlashClampU16(uEraseTypicalMs);
+	pChip->m_uSectorEraseMaxMs = FlashClampU16(uEraseMaxMs);
+
+	if (uChipTypical)
+	{
+		const u64 uChipTypicalMs = 1ull << (uChipTypical & 31);
+
+		pChip->m_uChipEraseTypicalMs = FlashClampU32(uChipTypicalMs);
+		pChip->m_uChipEraseMaxMs = FlashClampU32(uChipTypicalMs << (uChipMax & 15));
+	}
+	else
+	{
+		// No Chip Erase Figures, So Every Sector In Turn
+		pChip->m_uChipEraseTypicalMs = FlashClampU32((u64)uEraseTypicalMs * uNumSectors);
+		pChip->m_uChipEraseMaxMs = FlashClampU32((u64)uEraseMaxMs * uNumSectors);
+	}
+
+	s_flashROM.m_pChip = pChip;
+	s_flashROM.m_eManufacturer = uManufacturer;
+	s_flashROM.m_eVoltage = pChip->m_eVoltage;
+	s_flashROM.m_eBootSector = FLASH_SECTOR_REGIONS;
+	s_flashROM.m_u16Bit = b16Bit;
+	s_flashROM.m_uSoftwareIdExit = true;
+	s_flashROM.m_uNumSectors = uNumSectors;
+	s_flashROM.m_uSize = uBase;
+	s_flashROM.m_bInitialised = true;
+	return true;
+}
+
+//------------------------------------------------------------------------------------------------
+//---- FlashInitialise                                                                        ----
+//------------------------------------------------------------------------------------------------
+bool FlashInitialise(void)
+{
+	if (s_flashROM.m_bInitialised)
+		return false;
+
+	s_flashStatus.m_eStatus = FLASH_STATUS_OK;
+	s_flashStatus.m_uAddress = 0;
+
+	flash_software_id_entry();
+	sleep_ms(16);				// Give the IC time to exit standby mode.
+
+	const u8 uManufacturer = flash_read_byte(0);
+	const u8 uDeviceId8 = flash_read_byte(1);
+	const u16 uDeviceId16 = flash_read_word(1);
+	const flashChip* pChip = NULL;
+
+	for (u32 i=0; i<(sizeof(s_aFlashChips) / sizeof(s_aFlashChips[0])); ++i)
+	{
+		const flashChip* pEntry = &s_aFlashChips[i];
+
+		if ((pEntry->m_eManufacturer == uManufacturer) && (pEntry->m_uDeviceId == (pEntry->m_u16Bit ? uDeviceId16 : uDeviceId8)))
+		{
+			pChip = pEntry;
+			break;
+		}
+	}
+
+	if (NULL == pChip)
+	{
+		// Not Listed, Leave ID Mode Both Ways And Ask The Chip To Describe Itself
+		flash_command_mode_write();
+		flash_command_sequence(0x5555, 0xF0);
+		flash_command_mode_read();
+		flash_reset();
+
+		if (!FlashQueryCFI(uManufacturer, uDeviceId8))
+			return (false);
+
+		FlashSelectAccess();
+		return (true);
+	}
+
+	s_flashROM.m_pChip = pChip;
+	s_flashROM.m_eManufacturer = pChip->m_eManufacturer;
+	s_flashROM.m_eVoltage = pChip->m_eVoltage;
+	s_flashROM.m_eBootSector = pChip->m_eBootSector;
+	s_flashROM.m_u16Bit = pChip->m_u16Bit;
+	s_flashROM.m_uSoftwareIdExit = pChip->m_uSoftwareIdExit;
+	s_flashROM.m_uNumSectors = pChip->m_uNumSectors;
+	s_flashROM.m_uSize = (u32)pChip->m_uNumSectors << ((FLASH_SECTOR_4K == pChip->m_eBootSector) ? 12 : 16);
+	s_flashROM.m_bInitialised = true;
+
+	flash_software_id_exit();
+	FlashSelectAccess();
+
+	return (s_flashROM.m_bInitialised);
+}
+
+//------------------------------------------------------------------------------------------------
+//---- FlashProbe - Cheap software ID read, true if a known or CFI flash IC answers           ----
+//------------------------------------------------------------------------------------------------
+bool FlashProbe(void)
+{
+	flash_software_id_entry();
+	sleep_us(10);
+
+	const u8 uManufacturer = flash_read_byte(0);
+
+	// Exit Both Ways As We Don't Know Yet Which One The Chip Supports
+	flash_command_mode_write();
+	flash_command_sequence(0x5555, 0xF0);
+	flash_command_mode_read();
+	flash_reset();
+
+	for (u32 i=0; i<(sizeof(s_aFlashChips) / sizeof(s_aFlashChips[0])); ++i)
+	{
+		if (s_aFlashChips[i].m_eManufacturer == uManufacturer)
+			return true;
+	}
+
+	// FlashInitialise Takes Unlisted Parts That Answer A CFI Query, So They Count As Present Too
+	if (!FlashEnterCFI())
+		return false;
+
+	FlashExitCFI();
+	return true;
+}
+
+//------------------------------------------------------------------------------------------------
+//---- Background Erase                                                                       ----
+//------------------------------------------------------------------------------------------------
+//---- NOTE:  A Sector Erase Keeps Running While The Rest Of The Chip Is Read. Reads Of Other ----
+//----        Sectors Suspend It (0xB0) And Resume It (0x30) Around Themselves, Or Around A   ----
+//----        Whole Run Of Them Inside FlashEraseHold. Reads Of The Erasing Sectors, Programs ----
+//----        And Parts Without Suspend Wait For It To Finish.                                ----
+//------------------------------------------------------------------------------------------------
+typedef struct
+{
+	u32		m_aSectors[FLASH_ERASE_BATCH];
+	u32		m_aLengths[FLASH_ERASE_BATCH];
+	u32		m_uNumSectors;					// 0 When No Erase Is Running
+	u32		m_uHolds;						// FlashEraseHold Nesting, Reads Stay Suspended While Set
+	bool	m_bSuspended;
+	bool	m_bFailed;						// Held Until FlashEraseFinish
+	u64		m_uStartUs;
+	u64		m_uSuspendedUs;					// Total Time Spent Suspended
+	u64		m_uSuspendStartUs;
+	u64		m_uResumeUs;
+} flashErase;
+
+static flashErase s_flashErase = {0};
+
+//------------------------------------------------------------------------------------------------
+//---- FlashEraseBusAddress - Any address in the erase will do for commands and status        ----
+//------------------------------------------------------------------------------------------------
+static u32 FlashEraseBusAddress(void)
+{
+	return s_flashErase.m_aSectors[0] >> s_pFlashBus->m_uAddressShift;
+}
+
+//------------------------------------------------------------------------------------------------
+//---- FlashEraseResume                                                                       ----
+//------------------------------------------------------------------------------------------------
+static void FlashEraseResume(void)
+{
+	assert(s_flashErase.m_bSuspended);
+
+	flash_command_mode_write();
+	flash_command_byte(FlashEraseBusAddress(), 0x30);
+	flash_command_mode_read();
+
+	const u64 uNowUs = time_us_64();
+	s_flashErase.m_uSuspendedUs += uNowUs - s_flashErase.m_uSuspendStartUs;
+	s_flashErase.m_uResumeUs = uNowUs;
+	s_flashErase.m_bSuspended = false;
+}
+
+//------------------------------------------------------------------------------------------------
+//---- FlashEraseComplete - Wait for a running erase, a failure is kept for FlashEraseFinish  ----
+//------------------------------------------------------------------------------------------------
+static void FlashEraseComplete(void)
+{
+	if (0 == s_flashErase.m_uNumSectors)
+		return;
+
+	if (s_flashErase.m_bSuspended)
+		FlashEraseResume();
+
+	// Only What Is Left Of The Typical And Maximum Times, Suspended Time Doesn't Count
+	const u32 uRunUs = (u32)(time_us_64() - s_flashErase.m_uStartUs - s_flashErase.m_uSuspendedUs);
+	const u32 uTypicalUs = s_flashTiming.m_uEraseTypicalUs * s_flashErase.m_uNumSectors;
+	const u32 uMaxUs = s_flashTiming.m_uEraseMaxUs * s_flashErase.m_uNumSectors;
+
+	if (!flash_wait_ready(FlashEraseBusAddress(), (uRunUs < uTypicalUs) ? (uTypicalUs - uRunUs) : 0, (uRunUs < uMaxUs) ? (uMaxUs - uRunUs) : 0, s_flashTiming.m_uEraseTypicalUs >> 4))
+		s_flashErase.m_bFailed = true;
+
+	EVENT_TRACE(EVENT_FLASH_ERASE_END, !s_flashErase.m_bFailed);
+	s_flashErase.m_uNumSectors = 0;
+}
+
+//------------------------------------------------------------------------------------------------
+//---- FlashEraseSuspend                                                                      ----
+//------------------------------------------------------------------------------------------------
+static void FlashEraseSuspend(void)
+{
+	assert(!s_flashErase.m_bSuspended);
+
+	// Back To Back Suspends Would Starve The Erase, So Let It Run A While First
+	const u32 uRunUs = (u32)(time_us_64() - s_flashErase.m_uResumeUs);
+
+	if (uRunUs < FLASH_ERASE_MIN_RUN_US)
+		busy_wait_us_32(FLASH_ERASE_MIN_RUN_US - uRunUs);
+
+	flash_command_mode_write();
+	flash_command_byte(FlashEraseBusAddress(), 0xB0);
+	s_flashErase.m_uSuspendStartUs = time_us_64();
+
+	// DQ6 Stops Toggling Once Suspended, Or Because The Erase Has Just Finished
+	if (!flash_wait_ready(FlashEraseBusAddress(), 0, FLASH_SUSPEND_MAX_US, 0))
+	{
+		// The Chip Ignored The Suspend So The Erase May Still Be Running, Wait It Out Before Any Read
+		s_flashErase.m_bFailed = true;
+		FlashEraseComplete();
+		return;
+	}
+
+	s_flashErase.m_bSuspended = true;
+}
+
+//------------------------------------------------------------------------------------------------
+//---- FlashErasePause - Make a range readable, true if the caller must FlashEraseResume      ----
+//------------------------------------------------------------------------------------------------
+static bool FlashErasePause(const u32 uAddress, const u32 uLength)
+{
+	if (0 == s_flashErase.m_uNumSectors)
+		return false;
+
+	bool bOverlaps = false;
+
+	for (u32 i=0; i<s_flashErase.m_uNumSectors; ++i)
+	{
+		if ((uAddress < (s_flashErase.m_aSectors[i] + s_flashErase.m_aLengths[i])) && (s_flashErase.m_aSectors[i] < (uAddress + uLength)))
+			bOverlaps = true;
+	}
+
+	if (bOverlaps || !FlashHasAlgorithm(FLASH_ALGORITHM_ERASE_SUSPEND))
+	{
+		FlashEraseComplete();
+		return false;
+	}
+
+	if (!s_flashErase.m_bSuspended)
+		FlashEraseSuspend();
+
+	// Inside A Hold The Resume Waits For FlashEraseHold(false)
+	return s_flashErase.m_bSuspended && (0 == s_flashErase.m_uHolds);
+}
+
+//------------------------------------------------------------------------------------------------
+//---- FlashEraseHold - Keep one suspend across a run of small reads                          ----
+//------------------------------------------------------------------------------------------------
+static void FlashEraseHold(const bool bHold)
+{
+	if (bHold)
+	{
+		++s_flashErase.m_uHolds;
+		return;
+	}
+
+	assert(s_flashErase.m_uHolds > 0);
+
+	if ((0 == --s_flashErase.m_uHolds) && s_flashErase.m_bSuspended)
+		FlashEraseResume();
+}
+
+//------------------------------------------------------------------------------------------------
+//---- FlashRead                                                                              ----
+//------------------------------------------------------------------------------------------------
+bool FlashRead(void* pData, const u32 uAddress, const u32 uLength)
+{
+    assert(s_flashROM.m_bInitialised);
+
+	if ((uAddress + uLength) > s_flashROM.m_uSize)
+		return false;
+
+	const bool bResume = FlashErasePause(uAddress, uLength);
+
+	EVENT_TRACE(EVENT_FLASH_READ_BEGIN, uAddress);
+	s_pFlashBus->m_pfnRead(pData, uAddress, uLength);
+	EVENT_TRACE(EVENT_FLASH_READ_END, uLength);
+
+	if (bResume)
+		FlashEraseResume();
+
+	return true;
+}
+
+//------------------------------------------------------------------------------------------------
+//---- FlashVerify                                                                            ----
+//------------------------------------------------------------------------------------------------
+bool FlashVerify(const void* pCompareData, const u32 uAddress, const u32 uLength)
+{
+    assert(s_flashROM.m_bInitialised);
+
+	if ((uAddress + uLength) > s_flashROM.m_uSize)
+		return false;
+
+	const bool bResume = FlashErasePause(uAddress, uLength);
+	const bool bMatch = s_pFlashBus->m_pfnVerify(pCompareData, uAddress, uLength);
+
+	if (bResume)
+		FlashEraseResume();
+
+	return bMatch;
+}
+
+//------------------------------------------------------------------------------------------------
+//---- FlashGetSectorBase                                                                     ----
+//------------------------------------------------------------------------------------------------
+u32 FlashGetSectorBase(const u32 uAddress)
+{
+    assert(s_flashROM.m_bInitialised);
+	assert(uAddress < s_flashROM.m_uSize);
+
+	return s_pFlashGeometry->m_pfnGetSectorBase(uAddress);
+}
+
+//------------------------------------------------------------------------------------------------
+//---- FlashGetSectorLength                                                                   ----
+//------------------------------------------------------------------------------------------------
+u32 FlashGetSectorLength(const u32 uAddress)
+{
+    assert(s_flashROM.m_bInitialised);
+	assert(uAddress < s_flashROM.m_uSize);
+
+	return s_pFlashGeometry->m_pfnGetSectorLength(uAddress);
+}
+
+//------------------------------------------------------------------------------------------------
+//---- FlashIsErased - Check if the specified range is erased                                 ----
+//------------------------------------------------------------------------------------------------
+bool FlashIsErased(const u32 uAddress, const u32 uLength)
+{
+    assert(s_flashROM.m_bInitialised);
+
+	if ((uAddress + uLength) > s_flashROM.m_uSize)
+		return false;
+
+	const bool bResume = FlashErasePause(uAddress, uLength);
+	const bool bErased = s_pFlashBus->m_pfnIsErased(uAddress, uLength);
+
+	if (bResume)
+		FlashEraseResume();
+
+	return bErased;
+}
+
+//------------------------------------------------------------------------------------------------
+//---- FlashEraseStart - One erase command for every sector in pSectors, left running         ----
+//------------------------------------------------------------------------------------------------
+static void FlashEraseStart(const u32* pSectors, const u32 uNumSectors)
+{
+	assert((uNumSectors > 0) && (uNumSectors <= FLASH_ERASE_BATCH));
+	assert((1 == uNumSectors) || FlashHasAlgorithm(FLASH_ALGORITHM_MULTI_SECTOR_ERASE));
+
+	FlashEraseComplete();
+
+	for (u32 i=0; i<uNumSectors; ++i)
+	{
+		s_flashErase.m_aSectors[i] = pSectors[i];
+		s_flashErase.m_aLengths[i] = FlashGetSectorLength(pSectors[i]);
+	}
+
+	EVENT_TRACE(EVENT_FLASH_ERASE_BEGIN, pSectors[0]);
+
+	flash_command_mode_write();
+	flash_command_sequence(0x5555, 0x80);
+	flash_command_sequence(pSectors[0] >> s_pFlashBus->m_uAddressShift, 0x30);
+
+	// Each Further Sector Must Follow Within The 50us Erase Timeout, No Unlock Cycles
+	for (u32 i=1; i<uNumSectors; ++i)
+		flash_command_byte(pSectors[i] >> s_pFlashBus->m_uAddressShift, 0x30);
+
+	flash_command_mode_read();
+
+	s_flashErase.m_uNumSectors = uNumSectors;
+	s_flashErase.m_bSuspended = false;
+	s_flashErase.m_uStartUs = time_us_64();
+	s_flashErase.m_uResumeUs = s_flashErase.m_uStartUs;
+	s_flashErase.m_uSuspendedUs = 0;
+}
+
+//------------------------------------------------------------------------------------------------
+//---- FlashEraseFinish - Wait for any background erase, false if one has failed              ----
+//------------------------------------------------------------------------------------------------
+bool FlashEraseFinish(void)
+{
+	FlashEraseComplete();
+
+	const bool bSuccess = !s_flashErase.m_bFailed;
+	s_flashErase.m_bFailed = false;
+	return bSuccess;
+}
+
+//------------------------------------------------------------------------------------------------
+//---- FlashEraseSector - Erase the sector that uAddress is within                            ----
+//------------------------------------------------------------------------------------------------
+bool FlashEraseSector(const u32 uAddress, const bool bVerify)
+{
+    assert(s_flashROM.m_bInitialised);
+	const u32 uSectorAddress = FlashGetSectorBase(uAddress);
+	const u32 uLength = FlashGetSectorLength(uSectorAddress);
+
+	if (!FlashIsErased(uSectorAddress, uLength))
+		FlashEraseStart(&uSectorAddress, 1);
+
+	bool bSuccess = FlashEraseFinish();
+
+	if (bSuccess && bVerify)
+		bSuccess = FlashIsErased(uSectorAddress, uLength);
+
+    return bSuccess;
+}
+
+//------------------------------------------------------------------------------------------------
+//---- FlashEraseChip                                                                         ----
+//------------------------------------------------------------------------------------------------
+static bool FlashEraseChip(const bool bVerify)
+{
+	bool bSuccess = true;
+
+	FlashEraseComplete();
+
+	if (!FlashIsErased(0, s_flashROM.m_uSize))
+	{
+		flash_command_mode_write();
+		flash_command_sequence(0x5555, 0x80);
+		flash_command_sequence(0x5555, 0x10);
+
+		bSuccess = flash_wait_ready(0, s_flashTiming.m_uChipEraseTypicalUs, s_flashTiming.m_uChipEraseMaxUs, s_flashTiming.m_uChipEraseTypicalUs >> 4);
+	}
+
+	if (bSuccess && bVerify)
+		bSuccess = FlashIsErased(0, s_flashROM.m_uSize);
+
+	return bSuccess;
+}
+
+//------------------------------------------------------------------------------------------------
+//---- FlashEraseRangeBegin - Start erasing every sector the range touches, don't wait        ----
+//------------------------------------------------------------------------------------------------
+//---- NOTE:  Returns With The Last Batch Still Erasing, FlashEraseFinish Waits For It. Each  ----
+//----        Blank Check Runs While The Batch Before It Erases, If The Chip Can Suspend.     ----
+//------------------------------------------------------------------------------------------------
+bool FlashEraseRangeBegin(const u32 uAddress, const u32 uLength)
+{
+    assert(s_flashROM.m_bInitialised);
+
+	if ((0 == uLength) || ((uAddress + uLength) > s_flashROM.m_uSize))
+		return false;
+
+	const u32 uFirstSector = FlashGetSectorBase(uAddress);
+	const u32 uLastSector = FlashGetSectorBase(uAddress + uLength - 1);
+	const u32 uEnd = uLastSector + FlashGetSectorLength(uLastSector);
+	const u32 uBatch = FlashHasAlgorithm(FLASH_ALGORITHM_MULTI_SECTOR_ERASE) ? FLASH_ERASE_BATCH : 1;
+
+	// Only Sectors With Data In Are Erased, A Batch At A Time
+	u32 aSectors[FLASH_ERASE_BATCH];
+	u32 uNumSectors = 0;
+
+	for (u32 uSector=uFirstSector; uSector<uEnd; )
+	{
+		const u32 uSectorLength = FlashGetSectorLength(uSector);
+
+		if (!FlashIsErased(uSector, uSectorLength))
+			aSectors[uNumSectors++] = uSector;
+
+		uSector += uSectorLength;
+
+		if ((uBatch == uNumSectors) || ((uSector >= uEnd) && (uNumSectors > 0)))
+		{
+			FlashEraseStart(aSectors, uNumSectors);
+			uNumSectors = 0;
+
+			if (s_flashErase.m_bFailed)
+				return false;
+		}
+	}
+
+	return true;
+}
+
+//------------------------------------------------------------------------------------------------
+//---- FlashEraseRange - Erase every sector the range touches, fastest way the chip allows    ----
+//------------------------------------------------------------------------------------------------
+bool FlashEraseRange(const u32 uAddress, const u32 uLength, const bool bVerify)
+{
+    assert(s_flashROM.m_bInitialised);
+
+	if ((0 == uLength) || ((uAddress + uLength) > s_flashROM.m_uSize))
+		return false;
+
+	const u32 uFirstSector = FlashGetSectorBase(uAddress);
+	const u32 uLastSector = FlashGetSectorBase(uAddress + uLength - 1);
+	const u32 uEnd = uLastSector + FlashGetSectorLength(uLastSector);
+
+	// Without Multi Sector Erase The Whole Chip Is Quicker In One Go
+	if (!FlashHasAlgorithm(FLASH_ALGORITHM_MULTI_SECTOR_ERASE) && (0 == uFirstSector) && (s_flashROM.m_uSize == uEnd))
+		return FlashEraseChip(bVerify);
+
+	const bool bStarted = FlashEraseRangeBegin(uAddress, uLength);
+	const bool bFinished = FlashEraseFinish();
+
+	if (!bStarted || !bFinished)
+		return false;
+
+	if (!bVerify)
+		return true;
 
-	flash_software_id_exit();
+	return FlashIsErased(uFirstSector, uEnd - uFirstSector);
+}
 
-	return (s_flashROM.m_bInitialised);
+//------------------------------------------------------------------------------------------------
+//---- FlashErase - Erase the entire I.C.                                                     ----
+//------------------------------------------------------------------------------------------------
+bool FlashErase(const bool bVerify)
+{
+    assert(s_flashROM.m_bInitialised);
+
+	return FlashEraseRange(0, s_flashROM.m_uSize, bVerify);
 }
 
 //------------------------------------------------------------------------------------------------
-//---- FlashRead                                                                              ----
+//---- FlashWrite                                                                             ----
 //------------------------------------------------------------------------------------------------
-bool FlashRead(void* pData, const u32 uAddress, const u32 uLength)
+bool FlashWrite(const void* pData, const u32 uAddress, const u32 uLength, const bool bVerify)
 {
     assert(s_flashROM.m_bInitialised);
 
 	if ((uAddress + uLength) > s_flashROM.m_uSize)
 		return false;
 
-	if (s_flashROM.m_u16Bit)
-	{
-	    assert(0 == (uAddress & 1));
-	    assert(0 == (uLength & 1));
-		u16* pWordData = (u16*)pData;
-		const u32 uWordLength = (uLength + 1) >> 1;
+	if (!FlashIsErased(uAddress, uLength))
+		return false;
 
-		for (u32 i=0; i<uWordLength; ++i)
-			pWordData[i] = flash_read_word((uAddress >> 1) + i);
+	// Programming Waits For Any Background Erase To Finish
+	FlashEraseComplete();
 
-		return true;
-	}
+	EVENT_TRACE(EVENT_FLASH_BLOCK_BEGIN, uAddress);
+	const bool bProgrammed = s_pFlashBus->m_pfnProgram(pData, uAddress, uLength);
+	EVENT_TRACE(EVENT_FLASH_BLOCK_END, bProgrammed);
 
-	u8* pByteData = (u8*)pData;
+	if (!bProgrammed)
+		return false;
 
-	for (u32 i=0; i<uLength; ++i)
-		pByteData[i] = flash_read_byte(uAddress + i);
+	if (!bVerify)
+        return true;
 
-	return true;
+    return FlashVerify(pData, uAddress, uLength);
 }
 
 //------------------------------------------------------------------------------------------------
-//---- FlashVerify                                                                            ----
+//---- FlashUpdate - Verify each block, program it only where it differs and is erased        ----
 //------------------------------------------------------------------------------------------------
-bool FlashVerify(const void* pCompareData, const u32 uAddress, const u32 uLength)
+bool FlashUpdate(const u8* pData, const u32 uRomOffset, const u32 uLength)
 {
-    assert(s_flashROM.m_bInitialised);
+	bool bVerifySuccess = true;
 
-	if ((uAddress + uLength) > s_flashROM.m_uSize)
-		return false;
+	// 1K Verifies Would Suspend A Background Erase Each Time, So Only Once For The Lot
+	FlashEraseHold(true);
 
-	if (s_flashROM.m_u16Bit)
+	for (u32 uBlock=0; bVerifySuccess && (uBlock < uLength); uBlock += FLASH_BLOCK_SIZE)
 	{
-	    assert(0 == (uAddress & 1));
-	    assert(0 == (uLength & 1));
-		u16* pWordData = (u16*)pCompareData;
-		const u32 uWordLength = (uLength + 1) >> 1;
+		const u8* pBlock = &pData[uBlock];
+		const u32 uBlockOffset = uRomOffset + uBlock;
+		const u32 uBlockLength = ((uLength - uBlock) < FLASH_BLOCK_SIZE) ? (uLength - uBlock) : FLASH_BLOCK_SIZE;
 
-		for (u32 i=0; i<uWordLength; ++i)
+		// Check If The Data Is Already Correct, A Block Of 0xFF Can Be Valid Data
+		if (!FlashVerify(pBlock, uBlockOffset, uBlockLength))
 		{
-			if (pWordData[i] != flash_read_word((uAddress >> 1) + i))
-				return false;
+			// If The Data Is Incorrect Check If The Buffer Area Is Erased
+			if (FlashIsErased(uBlockOffset, uBlockLength))
+			{
+				// Area Is Erased So Write And Verify The Buffer
+				bVerifySuccess = FlashWrite(pBlock, uBlockOffset, uBlockLength, true);
+			}
+			else
+			{
+				// Data Is Incorrect And The Area Is Not Erased
+				// There Is Nothing More We Can Do So ERROR!
+				bVerifySuccess = false;
+			}
 		}
-
-		return true;
 	}
 
-	u8* pByteData = (u8*)pCompareData;
+	FlashEraseHold(false);
+	return bVerifySuccess;
+}
 
-	for (u32 i=0; i<uLength; ++i)
-	{
-		if (pByteData[i] != flash_read_byte(uAddress + i))
-			return false;
-	}
+//------------------------------------------------------------------------------------------------
+//---- FlashReadImage - FlashRead, back in the byte order the image files use                 ----
+//------------------------------------------------------------------------------------------------
+bool FlashReadImage(void* pData, const u32 uAddress, const u32 uLength)
+{
+	if (!FlashRead(pData, uAddress, uLength))
+		return false;
+
+	if (s_flashROM.m_u16Bit)
+		RomTransform_ByteSwap16((u8*)pData, uLength);
 
 	return true;
 }
 
 //------------------------------------------------------------------------------------------------
-//---- FlashGetSectorBase                                                                     ----
+//---- FlashPipeline_Progress                                                                 ----
 //------------------------------------------------------------------------------------------------
-static const u32 s_uBottomBoot64kOffset[8] =
+static void FlashPipeline_Progress(const u32 uDone, const u32 uTotal)
 {
-	0,				// 16k Block
-	0,
-	16384,			// 8k  Block
-	24576,			// 8k  Block
-	32768,			// 32k Block
-	32768,
-	32768,
-	32768
-};
+	// Only A Queue Post, Core 1 Does The Drawing
+	RenderQueue_Progress(PROGRESS_CHAR_X, PROGRESS_CHAR_Y, PROGRESS_WIDTH, uDone, uTotal, RGB111_GREEN);
+}
 
-static const u32 s_uTopBoot64kOffset[8] =
+//------------------------------------------------------------------------------------------------
+//---- FlashPipeline_Initialise - Transform pipeline that ends in FlashUpdate                 ----
+//------------------------------------------------------------------------------------------------
+void FlashPipeline_Initialise(RomPipeline* pPipeline)
 {
-	0,				// 32k Block
-	0,
-	0,
-	0,
-	32768,			// 8k Block
-	40960,			// 8k Block
-	49152,			// 16k Block
-	49152
-};
+	RomPipeline_Initialise(pPipeline, FlashUpdate, FlashIsErased, FlashPipeline_Progress);
 
-u32 FlashGetSectorBase(const u32 uAddress)
+	// Images Hold 16 Bit Words High Byte First, Swapped A Buffer At A Time Here Rather Than On The Bus
+	if (s_flashROM.m_u16Bit)
+		RomPipeline_AddByteSwap16(pPipeline);
+}
+
+//------------------------------------------------------------------------------------------------
+//---- FlashUpdateCopy - Data in XIP flash goes through the read buffer to be transformed     ----
+//------------------------------------------------------------------------------------------------
+bool FlashUpdateCopy(RomPipeline* pPipeline, const u8* pSource, const u32 uImageOffset, const u32 uLength)
 {
-    assert(s_flashROM.m_bInitialised);
-	assert(uAddress < s_flashROM.m_uSize);
+	bool bVerifySuccess = true;
 
-	switch (s_flashROM.m_eBootSector)
+	for (u32 uDone=0; bVerifySuccess && (uDone < uLength); uDone += SD_READ_BUFFER_SIZE)
 	{
-		case FLASH_SECTOR_4K:
-			return (uAddress >> 12);
+		const u32 uChunkLength = ((uLength - uDone) < SD_READ_BUFFER_SIZE) ? (uLength - uDone) : SD_READ_BUFFER_SIZE;
 
-		case FLASH_SECTOR_64K_TOP_BOOT:
-		{
-			u32 uSector = uAddress >> 16;
-
-			if (uSector < s_flashROM.m_uNumSectors - 1)
-				return uAddress & 0xFFFF0000;
-			
-			// Else we are in the top sector....
-			const u32 u8kOffset = (uAddress >> 13) & 7;		// Divide By 8k
-			return (uAddress & 0xFFFF0000) + s_uTopBoot64kOffset[u8kOffset];
-		}
+		memcpy((void*)&s_aReadBuffer, pSource + uDone, uChunkLength);
+		bVerifySuccess = RomPipeline_Write(pPipeline, (u8*)&s_aReadBuffer, uImageOffset + uDone, uChunkLength);
+	}
 
-		case FLASH_SECTOR_64K_BOTTOM_BOOT:
-		{
-			u32 uSector = uAddress >> 16;
+	return bVerifySuccess;
+}
+
+//------------------------------------------------------------------------------------------------
+//---- FlashUpdateRaw - Stream a plain image, the first chunk is already in the read buffer   ----
+//------------------------------------------------------------------------------------------------
+bool FlashUpdateRaw(FF_IMAGE* pImage, UINT uBytesRead, RomPipeline* pPipeline)
+{
+	const u32 uLength = (u32)pImage->size;
+	bool bVerifySuccess = RomPipeline_Begin(pPipeline, uLength);
+	u32 uFileOffset = 0;
 
-			if (uSector > 0)
-				return uAddress & 0xFFFF0000;
+	while (bVerifySuccess && (0 != uBytesRead))
+	{
+		bVerifySuccess = RomPipeline_Write(pPipeline, (u8*)&s_aReadBuffer, uFileOffset, uBytesRead);
+		uFileOffset += uBytesRead;
+		uBytesRead = 0;
 
-			// Else we are in the bottom sector....
-			const u32 u8kOffset = (uAddress >> 13) & 7;		// Divide By 8k
-			return (s_uBottomBoot64kOffset[u8kOffset]);
-		}
+		// Contiguous Images Are Read Straight Off The Card In Large Multi-Block Transfers
+		if (bVerifySuccess && (uFileOffset < uLength))
+			bVerifySuccess = (FR_OK == ff_image_read(pImage, (void*)&s_aReadBuffer, uFileOffset, SD_READ_BUFFER_SIZE, &uBytesRead));
 	}
 
-	return 0;
+	return bVerifySuccess && (uFileOffset == uLength) && RomPipeline_Finish(pPipeline);
 }
 
 //------------------------------------------------------------------------------------------------
-//---- FlashGetSectorLength                                                                   ----
+//---- FlashUpdatePacked - Unpack a block at a time straight into the pipeline                ----
 //------------------------------------------------------------------------------------------------
-static const u32 s_uBottomBoot64kLength[8] =
+bool FlashUpdatePacked(RomUnpack* pUnpack, RomPipeline* pPipeline)
 {
-	16384,			// 16k Block
-	16384,
-	8192,			// 8k  Block
-	8192,			// 8k  Block
-	32768,			// 32k Block
-	32768,
-	32768,
-	32768
-};
+	const u32 uLength = RomUnpack_GetLength(pUnpack);
+	bool bVerifySuccess = RomPipeline_Begin(pPipeline, uLength);
+	u32 uDone = 0;
 
-static const u32 s_uTopBoot64kLength[8] =
-{
-	32768,			// 32k Block
-	32768,
-	32768,
-	32768,
-	8192,			// 8k  Block
-	8192,			// 8k  Block
-	16384,			// 16k Block
-	16384
-};
+	while (bVerifySuccess && (uDone < uLength))
+	{
+		const u32 uBlockLength = RomUnpack_Read(pUnpack, s_aUnpackBuffer, FLASH_BLOCK_SIZE);
 
-u32 FlashGetSectorLength(const u32 uAddress)
-{
-    assert(s_flashROM.m_bInitialised);
-	assert(uAddress < s_flashROM.m_uSize);
+		if (0 == uBlockLength)
+			break;
 
-	switch (s_flashROM.m_eBootSector)
-	{
-		case FLASH_SECTOR_4K:
-			return (4096);
+		bVerifySuccess = RomPipeline_Write(pPipeline, s_aUnpackBuffer, uDone, uBlockLength);
+		uDone += uBlockLength;
+	}
 
-		case FLASH_SECTOR_64K_TOP_BOOT:
-		{
-			u32 uSector = uAddress >> 16;
-
-			if (uSector < s_flashROM.m_uNumSectors - 1)
-				return 65536;
-			
-			// Else we are in the top sector....
-			const u32 u8kOffset = (uAddress >> 13) & 7;		// Divide By 8k
-			return s_uTopBoot64kLength[u8kOffset];
-		}
+	// The Unpacked CRC Covers The SD Read And The Decoder, Flash Itself Was Verified Block By Block
+	return bVerifySuccess && RomUnpack_Finish(pUnpack) && RomPipeline_Finish(pPipeline);
+}
 
-		case FLASH_SECTOR_64K_BOTTOM_BOOT:
-		{
-			u32 uSector = uAddress >> 16;
+typedef struct
+{
+	FF_IMAGE*	m_pImage;
+	u32			m_uFileOffset;				// Next Read, Always Sector Aligned
+} SDCardRefill;
 
-			if (uSector > 0)
-				return 65536;
+//------------------------------------------------------------------------------------------------
+//---- SDCard_Refill - Feeds the decoder the next chunk of a packed image                     ----
+//------------------------------------------------------------------------------------------------
+static u32 SDCard_Refill(void* pContext, const u8** ppInput)
+{
+	SDCardRefill* pRefill = (SDCardRefill*)pContext;
+	UINT uBytesRead;
 
-			// Else we are in the bottom sector....
-			const u32 u8kOffset = (uAddress >> 13) & 7;		// Divide By 8k
-			return s_uBottomBoot64kLength[u8kOffset];
-		}
-	}
+	if (pRefill->m_uFileOffset >= pRefill->m_pImage->size)
+		return 0;
 
-	return s_flashROM.m_uSize;
+	if (FR_OK != ff_image_read(pRefill->m_pImage, (void*)&s_aReadBuffer, pRefill->m_uFileOffset, SD_READ_BUFFER_SIZE, &uBytesRead))
+		return 0;
+
+	pRefill->m_uFileOffset += uBytesRead;
+	*ppInput = (const u8*)&s_aReadBuffer;
+	return uBytesRead;
 }
 
 //------------------------------------------------------------------------------------------------
-//---- FlashIsErased - Check if the specified range is erased                                 ----
+//---- FlashUpdateSparse - Program the data extents, blank check the holes                    ----
 //------------------------------------------------------------------------------------------------
-bool FlashIsErased(const u32 uAddress, const u32 uLength)
+//---- NOTE:  pFile Holds At Least The Header And Extent Table. pImage Is The File On The SD  ----
+//----        Card, Or NULL If pFile Is The Whole File (Cached In XIP Flash).                 ----
+//------------------------------------------------------------------------------------------------
+bool FlashUpdateSparse(const u8* pFile, const u32 uLength, FF_IMAGE* pImage, const u32 uFileSize, RomPipeline* pPipeline)
 {
-    assert(s_flashROM.m_bInitialised);
-
-	if ((uAddress + uLength) > s_flashROM.m_uSize)
-		return false;
+	u32 uImageLength;
+	const u32 uNumExtents = RomSparse_LoadExtents(pFile, uLength, uFileSize, s_aSparseExtents, &uImageLength);
+	bool bVerifySuccess = (0 != uNumExtents) && RomPipeline_Begin(pPipeline, uImageLength);
 
-	if (s_flashROM.m_u16Bit)
+	for (u32 uExtent=0; bVerifySuccess && (uExtent < uNumExtents); ++uExtent)
 	{
-	    assert(0 == (uAddress & 1));
-	    assert(0 == (uLength & 1));
-		const u32 uWordLength = (uLength + 1) >> 1;
+		const RomSparseExtent* pExtent = &s_aSparseExtents[uExtent];
 
-		for (u32 i=0; i<uWordLength; ++i)
+		if (RomSparse_IsHole(pExtent))
 		{
-			if (0xFFFF != flash_read_word((uAddress >> 1) + i))
-				return false;
-		}
+			// Nothing To Read Or Write, Only Needs To Be Blank
+			for (u32 uDone=0; bVerifySuccess && (uDone < pExtent->m_uLength); uDone += SD_READ_BUFFER_SIZE)
+			{
+				const u32 uChunkLength = ((pExtent->m_uLength - uDone) < SD_READ_BUFFER_SIZE) ? (pExtent->m_uLength - uDone) : SD_READ_BUFFER_SIZE;
 
-		return true;
-	}
+				bVerifySuccess = RomPipeline_Blank(pPipeline, pExtent->m_uOffset + uDone, uChunkLength);
+			}
+		}
+		else if (NULL == pImage)
+		{
+			bVerifySuccess = FlashUpdateCopy(pPipeline, pFile + pExtent->m_uFileOffset, pExtent->m_uOffset, pExtent->m_uLength);
+		}
+		else
+		{
+			// Data Extents Are Sector Aligned In The File So Each One Is A Straight Run Of Reads
+			for (u32 uDone=0; bVerifySuccess && (uDone < pExtent->m_uLength); uDone += SD_READ_BUFFER_SIZE)
+			{
+				const u32 uChunkLength = ((pExtent->m_uLength - uDone) < SD_READ_BUFFER_SIZE) ? (pExtent->m_uLength - uDone) : SD_READ_BUFFER_SIZE;
+				UINT uBytesRead;
 
-	for (u32 i=0; i<uLength; ++i)
-	{
-		if (0xFF != flash_read_byte(uAddress + i))
-			return false;
+				const FRESULT fr = ff_image_read(pImage, (void*)&s_aReadBuffer, pExtent->m_uFileOffset + uDone, uChunkLength, &uBytesRead);
+				bVerifySuccess = (FR_OK == fr) && (uBytesRead == uChunkLength) &&
+								 RomPipeline_Write(pPipeline, (u8*)&s_aReadBuffer, pExtent->m_uOffset + uDone, uChunkLength);
+			}
+		}
 	}
 
-	return true;
+	return bVerifySuccess && RomPipeline_Finish(pPipeline);
 }
 
 //------------------------------------------------------------------------------------------------
-//---- FlashEraseSector - Erase the sector that uAddress is within                            ----
+//---- SDCard_WriteImage																	  ----
 //------------------------------------------------------------------------------------------------
-bool FlashEraseSector(const u32 uAddress, const bool bVerify)
+//---- NOTE:  This Function Will Do A Verify Without Writing If The Data Is Already Correct	  ----
+//---- NOTE:  The Image Is Cached In Pico Flash On First Use And Streamed From There After    ----
+//---- NOTE:  Images Packed With Tools/rom_pack.py Are Unpacked On The Fly, Cached Packed     ----
+//---- NOTE:  Sparse Images From Tools/rom_sparse.py Only Read And Program Their Data Extents ----
+//---- NOTE:  pPipeline Comes From FlashPipeline_Initialise Plus Any Layout Stages            ----
+//------------------------------------------------------------------------------------------------
+bool SDCard_WriteImage(const char* const pszFileName, RomPipeline* pPipeline)
 {
-    assert(s_flashROM.m_bInitialised);
-	const u32 uSectorAddress = FlashGetSectorBase(uAddress);
-	const u32 uLength = FlashGetSectorLength(uSectorAddress);
-	bool bSuccess = true;
+	// Images Already Cached In The Pico's Own Flash Only Cost An f_stat
+	u32 uCachedSize;
+	const u8* pCached = ImageCache_Get(pszFileName, &uCachedSize, (u8*)s_aReadBuffer, SD_READ_BUFFER_SIZE);
 
-	if (!FlashIsErased(uSectorAddress, uLength))
+	if (NULL != pCached)
 	{
-		flash_command_mode_write();
-		flash_command_sequence(0x5555, 0x80);
+		if (RomUnpack_Begin(&s_romUnpack, pCached, uCachedSize, NULL, NULL))
+			return FlashUpdatePacked(&s_romUnpack, pPipeline);
+
+		if (RomSparse_IsSparse(pCached, uCachedSize))
+			return FlashUpdateSparse(pCached, uCachedSize, NULL, uCachedSize, pPipeline);
+
+		return RomPipeline_Begin(pPipeline, uCachedSize) && FlashUpdateCopy(pPipeline, pCached, 0, uCachedSize) && RomPipeline_Finish(pPipeline);
+	}
+
+	FF_IMAGE image;
+	FRESULT fr = ff_image_open(&image, pszFileName);
+	if (FR_OK == fr)
+	{
+		SDCardRefill refill = { &image, 0 };
+		bool bVerifySuccess = false;
+		UINT uBytesRead;
+
+		fr = ff_image_read(&image, (void*)&s_aReadBuffer, 0, SD_READ_BUFFER_SIZE, &uBytesRead);
 
-		if (s_flashROM.m_u16Bit)
+		if (FR_OK != fr)
 		{
-			flash_command_sequence(uAddress >> 1, 0x30);
+			bVerifySuccess = false;
+		}
+		else if (RomUnpack_Begin(&s_romUnpack, (const u8*)&s_aReadBuffer, uBytesRead, SDCard_Refill, &refill))
+		{
+			// A Packed Image Is Recognised By Its Header, The Decoder Pulls The Rest Of The File Itself
+			refill.m_uFileOffset = uBytesRead;
+			bVerifySuccess = FlashUpdatePacked(&s_romUnpack, pPipeline);
+		}
+		else if (RomSparse_IsSparse((const u8*)&s_aReadBuffer, uBytesRead))
+		{
+			// Sparse Images Seek Straight To Each Data Extent, The Holes Are Never Read
+			bVerifySuccess = FlashUpdateSparse((const u8*)&s_aReadBuffer, uBytesRead, &image, (u32)image.size, pPipeline);
 		}
 		else
 		{
-			flash_command_sequence(uAddress, 0x30);
+			bVerifySuccess = FlashUpdateRaw(&image, uBytesRead, pPipeline);
 		}
 
-		busy_wait_at_least_cycles(15);
-		flash_command_mode_read();
-		gpio_set_dir_in_masked(((1 << 16) - 1) << PIN_IO0);
-
-		do
-		{
-			busy_wait_at_least_cycles(9);
-		} while ( 0 == ((gpio_get_all() >> PIN_IO0) & 0x80) );
+		ff_image_close(&image);
+		return bVerifySuccess;
 	}
+	// else
+	// {
+	// 	char szTempString[128];
+	// 	sprintf(szTempString, "can't open file: %s", pszFileName);
+	// }
 
-	if (bVerify)
-		bSuccess = FlashIsErased(uSectorAddress, uLength);
-
-    return bSuccess;
+	return false;
 }
 
 //------------------------------------------------------------------------------------------------
-//---- FlashErase - Erase the entire I.C.                                                     ----
+//---- SDCard_WriteToFlash																	  ----
 //------------------------------------------------------------------------------------------------
-bool FlashErase(const bool bVerify)
+bool SDCard_WriteToFlash(const char* const pszFileName, const u32 uFlashOffset)
 {
-    assert(s_flashROM.m_bInitialised);
-	bool bSuccess = true;
+	RomPipeline pipeline;
+	FlashPipeline_Initialise(&pipeline);
+	RomPipeline_AddRelocate(&pipeline, uFlashOffset);
 
-	if (!FlashIsErased(0, s_flashROM.m_uSize))
-	{
-		flash_command_mode_write();
-		flash_command_sequence(0x5555, 0x80);
-		flash_command_sequence(0x5555, 0x10);
+	return SDCard_WriteImage(pszFileName, &pipeline);
+}
 
-		busy_wait_at_least_cycles(15);
-		flash_command_mode_read();
-		gpio_set_dir_in_masked(((1 << 16) - 1) << PIN_IO0);
+//------------------------------------------------------------------------------------------------
+//---- SDCard_DumpFlash																		  ----
+//------------------------------------------------------------------------------------------------
+//---- NOTE:  The File Is Preallocated Contiguously So The Dump Streams Straight To The Card  ----
+//------------------------------------------------------------------------------------------------
+bool SDCard_DumpFlash(const char* const pszFileName, const u32 uFlashOffset, const u32 uLength)
+{
+	FF_IMAGE image;
+	FRESULT fr = ff_image_create(&image, pszFileName, uLength);
+	if (FR_OK == fr)
+	{
+		bool bDumpSuccess = true;
 
-		do
+		for (u32 uFileOffset=0; bDumpSuccess && (uFileOffset < uLength); uFileOffset += SD_READ_BUFFER_SIZE)
 		{
-			busy_wait_at_least_cycles(9);
-		} while ( 0 == ((gpio_get_all() >> PIN_IO0) & 0x80) );
-	}
+			const u32 uChunkLength = ((uLength - uFileOffset) < SD_READ_BUFFER_SIZE) ? (uLength - uFileOffset) : SD_READ_BUFFER_SIZE;
+			UINT uBytesWritten;
 
-	if (bVerify)
-		bSuccess = FlashIsErased(0, s_flashROM.m_uSize);
+			// The Card Is Still Programming The Last Chunk While The Next One Is Read From Flash
+			bDumpSuccess = FlashReadImage((void*)&s_aReadBuffer, uFlashOffset + uFileOffset, uChunkLength);
 
-	return bSuccess;
+			if (bDumpSuccess)
+			{
+				fr = ff_image_write(&image, (void*)&s_aReadBuffer, uFileOffset, uChunkLength, &uBytesWritten);
+				bDumpSuccess = (FR_OK == fr) && (uBytesWritten == uChunkLength);
+			}
+
+			RenderQueue_Progress(PROGRESS_CHAR_X, PROGRESS_CHAR_Y, PROGRESS_WIDTH, uFileOffset + uChunkLength, uLength, RGB111_GREEN);
+		}
+
+		// Only The Directory Entry Is Written Here, The FAT Chain Went Down When The File Was Created
+		fr = ff_image_close(&image);
+		return bDumpSuccess && (FR_OK == fr);
+	}
+
+	return false;
 }
 
 //------------------------------------------------------------------------------------------------
-//---- FlashWrite                                                                             ----
+//---- ProductionLine_WaitFor - Debounced wait for the cart to appear or go                   ----
 //------------------------------------------------------------------------------------------------
-bool FlashWrite(const void* pData, const u32 uAddress, const u32 uLength, const bool bVerify)
+static void ProductionLine_WaitFor(const bool bPresent)
 {
-    assert(s_flashROM.m_bInitialised);
-
-	if ((uAddress + uLength) > s_flashROM.m_uSize)
-		return false;
-
-	if (!FlashIsErased(uAddress, uLength))
-		return false;
+	u32 uAgree = 0;
 
-	if (s_flashROM.m_u16Bit)
-	{
-	    assert(0 == (uAddress & 1));
-	    assert(0 == (uLength & 1));
-		u16* pWordData = (u16*)pData;
-		const u32 uWordLength = (uLength + 1) >> 1;
-
-		for (u32 i=0; i<uWordLength; ++i)
-			flash_write_word((uAddress >> 1) + i, swap_u16(pWordData[i]));
-	}
-	else
+	while (uAgree < PRODUCTION_DEBOUNCE)
 	{
-		u8* pByteData = (u8*)pData;
-		
-		for (u32 i=0; i<uLength; ++i)
-			flash_write_byte(uAddress + i, pByteData[i]);
+		sleep_ms(PRODUCTION_POLL_MS);
+		uAgree = (FlashProbe() == bPresent) ? (uAgree + 1) : 0;
 	}
-
-	if (!bVerify)
-        return true;
-
-    return FlashVerify(pData, uAddress, uLength);
 }
 
 //------------------------------------------------------------------------------------------------
-//---- SDCard_WriteToFlash																	  ----
+//---- ProductionLine                                                                         ----
 //------------------------------------------------------------------------------------------------
-//---- NOTE:  This Function Will Do A Verify Without Writing If The Data Is Already Correct	  ----
+//---- NOTE:  Never Returns. Each Cart Is Programmed And Verified When Inserted, The Result   ----
+//----        Stays On Screen Until It Is Pulled, Then We Re-Arm For The Next One.            ----
 //------------------------------------------------------------------------------------------------
-bool SDCard_WriteToFlash(const char* const pszFileName, const u32 uFlashOffset)
+void ProductionLine(const char* const pszFileName, const u32 uFlashOffset)
 {
-	FIL fil;
-	FRESULT fr = f_open(&fil, pszFileName, FA_OPEN_EXISTING | FA_READ);
-	if (FR_OK == fr)
+	u32 uPassed = 0;
+	u32 uFailed = 0;
+	u32 uTotalCycleMs = 0;
+	u32 uFirstStartMs = 0;
+
+	RenderQueue_Printf(2, 2, RGB111_YELLOW, "Production Line: %-40s", pszFileName);
+
+	while (true)
 	{
-		const u32 uRomSize = f_size(&fil);
-		bool bVerifySuccess = true;
-		u32 uRomOffset = uFlashOffset;
-		u32 uBytesRead;
+		RenderQueue_DrawString(2, 3, "Insert Cart...                   ", RGB111_YELLOW);
+		ProductionLine_WaitFor(true);
 
-		while(bVerifySuccess)
-		{
-			f_read(&fil, (void*)&s_aReadBuffer, 1024, &uBytesRead);
+		const u32 uStartMs = to_ms_since_boot(get_absolute_time());
+		if (0 == (uPassed + uFailed))
+			uFirstStartMs = uStartMs;
 
-			if (0 == uBytesRead)
-				break;
+		RenderQueue_DrawString(2, 3, "Programming...                   ", RGB111_YELLOW);
+		RenderQueue_DrawString(2, 4, "                                 ", RGB111_YELLOW);
+		RenderQueue_Progress(PROGRESS_CHAR_X, PROGRESS_CHAR_Y, PROGRESS_WIDTH, 0, 1, RGB111_GREEN);
 
-			// Check If The Data Is Already Correct
-			// As the IO buffer is only 1k in size
-			// occasionally 1024 255's is the valid data!!!
-			// Kickstart 2.04 I'm looking at you!!!
-			if (!FlashVerify((void*)&s_aReadBuffer, uRomOffset, uBytesRead))
-			{
-				// If The Data Is Incorrect Check If The Buffer Area Is Erased
-				if (FlashIsErased(uRomOffset, uBytesRead))
-				{
-					// Area Is Erased So Write And Verify The Buffer
-					bVerifySuccess = FlashWrite((void*)&s_aReadBuffer, uRomOffset, uBytesRead, true);
-				}
-				else
-				{
-					// Data Is Incorrect And The Area Is Not Erased
-					// There Is Nothing More We Can Do So ERROR!
-					bVerifySuccess = false;
-				}
-			}
+		s_flashROM.m_bInitialised = false;
+		bool bPass = FlashInitialise() && SDCard_WriteToFlash(pszFileName, uFlashOffset);
+
+		// Carts Arrive With Old Contents, Erase Once And Try Again
+		if (!bPass && s_flashROM.m_bInitialised)
+			bPass = FlashErase(true) && SDCard_WriteToFlash(pszFileName, uFlashOffset);
 
-			uRomOffset += uBytesRead;
+		const u32 uEndMs = to_ms_since_boot(get_absolute_time());
+		uTotalCycleMs += uEndMs - uStartMs;
+
+		if (bPass)
+		{
+			++uPassed;
+			RenderQueue_Printf(2, 3, RGB111_GREEN, "Cart %d PASS - Remove Cart       ", uPassed + uFailed);
 		}
+		else
+		{
+			u32 uFailAddress = 0;
+			const u8 eStatus = FlashGetStatus(&uFailAddress);
 
-		f_close(&fil);
-		return bVerifySuccess;
-	}
-	// else
-	// {
-	// 	char szTempString[128];
-	// 	sprintf(szTempString, "can't open file: %s", pszFileName);
-	// }
+			++uFailed;
+			RenderQueue_Printf(2, 3, RGB111_RED, "Cart %d FAIL - Remove Cart       ", uPassed + uFailed);
+			RenderQueue_Printf(2, 4, RGB111_RED, "%-7s Error At %06X", s_apszFlashStatus[eStatus], uFailAddress);
+		}
 
-	return false;
+		const u32 uCarts = uPassed + uFailed;
+		const u32 uElapsedMs = (uEndMs - uFirstStartMs) ? (uEndMs - uFirstStartMs) : 1;
+		const u32 uCartsPerHour = (u32)(((u64)uCarts * 3600000) / uElapsedMs);
+
+		RenderQueue_Printf(2, 7, RGB111_WHITE, "Passed %d   Failed %d   %d Carts/Hour   ", uPassed, uFailed, uCartsPerHour);
+		RenderQueue_Printf(2, 8, RGB111_WHITE, "Cycle %d.%d s   Average %d.%d s   ", (uEndMs - uStartMs) / 1000, ((uEndMs - uStartMs) / 100) % 10,
+																					(uTotalCycleMs / uCarts) / 1000, ((uTotalCycleMs / uCarts) / 100) % 10);
+
+		ProductionLine_WaitFor(false);
+	}
 }
 
 //------------------------------------------------------------------------------------------------
@@ -847,6 +1940,7 @@ bool SDCard_WriteToFlash(const char* const pszFileName, const u32 uFlashOffset)
 int main()
 {
     stdio_init_all();
+	event_trace_init();
 	s_flashROM.m_bInitialised = false;
 
 	gpio_init(PIN_FLASH_RESET);
@@ -895,13 +1989,15 @@ int main()
 
     vga_Init(PIN_RED, PIN_HSYNC, PIN_VSYNC);
 
-	char szTempString[128];
 	vga_FilledRect(0, 0, VGA_RESOLUTION_X, VGA_RESOLUTION_Y, RGB111_GREEN);
 	vga_FilledRect(1, 1, VGA_RESOLUTION_X-2, VGA_RESOLUTION_Y-2, RGB111_BLACK);
+	RenderQueue_Initialise();
+	ImageCache_Initialise();
 
 	if (!FlashInitialise())
 	{
 		// Can't Initialise Flash So Take A Guess That A Mask ROM Is Inserted.
+		s_flashROM.m_pChip = NULL;
 		s_flashROM.m_eManufacturer = FLASH_MANUFACTURER_UNKNOWN;
 		s_flashROM.m_eVoltage = FLASH_VOLTAGE_5V0;
 		s_flashROM.m_eBootSector = FLASH_SECTOR_NONE;
@@ -910,57 +2006,66 @@ int main()
 		s_flashROM.m_uNumSectors = 1;
 		s_flashROM.m_uSize = 256 << 10;
 		s_flashROM.m_bInitialised = true;
+		FlashSelectAccess();
 	}
 
 	switch (s_flashROM.m_eManufacturer)
 	{
 		case FLASH_MANUFACTURER_MICRON:
-			vga_DrawString(2, 52, "Flash Manufacturer MICRON", RGB111_GREEN);
+			RenderQueue_DrawString(2, 52, "Flash Manufacturer MICRON", RGB111_GREEN);
 		break;
 
 		case FLASH_MANUFACTURER_SST:
-			vga_DrawString(2, 52, "Flash Manufacturer SST", RGB111_GREEN);
+			RenderQueue_DrawString(2, 52, "Flash Manufacturer SST", RGB111_GREEN);
 		break;
 
 		case FLASH_MANUFACTURER_MACRONIX:
-			vga_DrawString(2, 52, "Flash Manufacturer MACRONIX", RGB111_GREEN);
+			RenderQueue_DrawString(2, 52, "Flash Manufacturer MACRONIX", RGB111_GREEN);
 		break;
 
 		default:
-			vga_DrawString(2, 52, "Flash Manufacturer UNKNOWN", RGB111_GREEN);
+			RenderQueue_DrawString(2, 52, "Flash Manufacturer UNKNOWN", RGB111_GREEN);
 		break;
 	}
 
-	sprintf(szTempString, "Voltage %d.%d    %d Bit", s_flashROM.m_eVoltage >> 4, s_flashROM.m_eVoltage & 15, s_flashROM.m_u16Bit ? 16 : 8);
-	vga_DrawString(32, 52, szTempString, RGB111_GREEN);
+	RenderQueue_Printf(32, 52, RGB111_GREEN, "Voltage %d.%d    %d Bit", s_flashROM.m_eVoltage >> 4, s_flashROM.m_eVoltage & 15, s_flashROM.m_u16Bit ? 16 : 8);
 
 	switch (s_flashROM.m_eBootSector)
 	{
 		case FLASH_SECTOR_4K:
-			vga_DrawString(2, 54, "4k Sectors", RGB111_GREEN);
+			RenderQueue_DrawString(2, 54, "4k Sectors", RGB111_GREEN);
 		break;
 
 		case FLASH_SECTOR_64K_TOP_BOOT:
-			vga_DrawString(2, 54, "64k Sector Top Boot", RGB111_GREEN);
+			RenderQueue_DrawString(2, 54, "64k Sector Top Boot", RGB111_GREEN);
 		break;
 
 		case FLASH_SECTOR_64K_BOTTOM_BOOT:
-			vga_DrawString(2, 54, "64k Sector Bottom Boot", RGB111_GREEN);
+			RenderQueue_DrawString(2, 54, "64k Sector Bottom Boot", RGB111_GREEN);
+		break;
+
+		case FLASH_SECTOR_REGIONS:
+			RenderQueue_DrawString(2, 54, "CFI Sector Regions", RGB111_GREEN);
 		break;
 
 		default:
-			vga_DrawString(2, 54, "Boot Sector None", RGB111_GREEN);
+			RenderQueue_DrawString(2, 54, "Boot Sector None", RGB111_GREEN);
 		break;
 	}
 
-	sprintf(szTempString, "Sector Count = %d   Size = %d KBytes", s_flashROM.m_uNumSectors, s_flashROM.m_uSize >> 10);
-	vga_DrawString(27, 54, szTempString, RGB111_GREEN);
+	RenderQueue_Printf(27, 54, RGB111_GREEN, "Sector Count = %d   Size = %d KBytes", s_flashROM.m_uNumSectors, s_flashROM.m_uSize >> 10);
 
 	sd_card_t *pSD = sd_get_by_num(0);
 
 	FRESULT fr = f_mount(&pSD->fatfs, pSD->pcName, 1);
 	if (FR_OK == fr)
 	{
+		RenderQueue_Printf(2, 56, RGB111_GREEN, "SD Clock = %d.%d MHz", pSD->baud_rate / 1000000, (pSD->baud_rate / 100000) % 10);
+
+#if FLASHCART_PRODUCTION_LINE
+		ProductionLine(PRODUCTION_IMAGE, 0x00000000);
+#endif
+
 		// s_uTest = FlashGetSectorBase(80000);
 		// s_uTest = FlashGetSectorBase(2097152 - 1000);
 		// s_uTest = FlashGetSectorLength(80000);
@@ -979,34 +2084,59 @@ int main()
 		// if (bVerifySuccess)
 		// 	bVerifySuccess = SDCard_WriteToFlash("Kickstart_1_3.rom", 0x00080000);
 
+		// 256K Kickstart Mirrored To Fill A 512K Bank
+		// RomPipeline pipeline;
+		// FlashPipeline_Initialise(&pipeline);
+		// RomPipeline_AddMirror(&pipeline, 512 << 10);
+		// RomPipeline_AddRelocate(&pipeline, 0x00080000);
+		// if (bVerifySuccess)
+		// 	bVerifySuccess = SDCard_WriteImage("Kickstart_1_3.rom", &pipeline);
+
+		// Erase The Next Bank In The Background, Checks Of Other Banks Run While It Erases
+		// FlashEraseRangeBegin(0x00100000, 512 << 10);
+		// bVerifySuccess = SDCard_WriteToFlash("AmigaDiag.rom", 0x00000000) && FlashEraseFinish();
+
 		// if (bVerifySuccess)
 		// 	bVerifySuccess = SDCard_WriteToFlash("Kickstart_2_04.rom", 0x00100000);
 
 		// if (bVerifySuccess)
 		// 	bVerifySuccess = SDCard_WriteToFlash("Kickstart_3_1.rom", 0x00180000);
 
+		// if (bVerifySuccess)
+		// 	bVerifySuccess = SDCard_DumpFlash("FlashDump.bin", 0x00000000, s_flashROM.m_uSize);
+
 		if (bVerifySuccess)
 		{
-			vga_DrawString(2, 2, "Flash Verify Success!!!", RGB111_GREEN);
+			RenderQueue_DrawString(2, 2, "Flash Verify Success!!!", RGB111_GREEN);
 		}
 		else
 		{
 			if (FlashIsErased(0, s_flashROM.m_uSize))
 			{
-				vga_DrawString(2, 2, "Flash Empty!!!", RGB111_MAGENTA);
+				RenderQueue_DrawString(2, 2, "Flash Empty!!!", RGB111_MAGENTA);
 			}
 			else
 			{
-				vga_DrawString(2, 2, "Flash Verify Failed!!!", RGB111_RED);
+				u32 uFailAddress = 0;
+				const u8 eStatus = FlashGetStatus(&uFailAddress);
+
+				RenderQueue_DrawString(2, 2, "Flash Verify Failed!!!", RGB111_RED);
+
+				if (FLASH_STATUS_OK != eStatus)
+					RenderQueue_Printf(2, 3, RGB111_RED, "%s Error At %06X", s_apszFlashStatus[eStatus], uFailAddress);
 			}
 		}
 
+#if EVENT_TRACE_ENABLED
+		// Leave A Timeline Of The Run On The Card For Tools/trace_decode.py
+		event_trace_dump("EventTrace.bin");
+#endif
+
 	    f_unmount(pSD->pcName);
 	}
 	else
 	{
-		sprintf(szTempString, "f_mount error: %s (%d)", FRESULT_str(fr), fr);
-		vga_DrawString(2, 2, szTempString, RGB111_RED);
+		RenderQueue_Printf(2, 2, RGB111_RED, "f_mount error: %s (%d)", FRESULT_str(fr), fr);
 	}
 
 	// FIL fil;
@@ -1027,18 +2157,17 @@ int main()
 	const u32 uFlashOffset = 0;
 	for (u32 uLine=0; uLine<40; ++uLine)
 	{
-		u8 aLineBuffer[16];
+		u8 aLineBuffer[16] __attribute__((aligned(4)));
 		const u32 uAddress = uFlashOffset + (uLine << 4);
 
-		if (FlashRead(aLineBuffer, uAddress, 16))
-			FormatHexDumpLine(3, 10 + uLine, uAddress, aLineBuffer, RGB111_CYAN, s_flashROM.m_u16Bit ? true : false);
+		if (FlashReadImage(aLineBuffer, uAddress, 16))
+			RenderQueue_HexLine(3, 10 + uLine, uAddress, aLineBuffer, RGB111_CYAN, s_flashROM.m_u16Bit ? true : false);
 	}
 
 	u32 uOnTime = 0;
 	while(true)
 	{
-		sprintf(szTempString, "Time On = %d.%d", uOnTime / 50, (uOnTime % 50) * 2);
-		vga_DrawString(58, 2, szTempString, RGB111_YELLOW);
+		RenderQueue_Printf(58, 2, RGB111_YELLOW, "Time On = %d.%d", uOnTime / 50, (uOnTime % 50) * 2);
 		sleep_ms(16);
 		uOnTime++;
 	}
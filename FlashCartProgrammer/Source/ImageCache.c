@@ -0,0 +1,238 @@
+//------------------------------------------------------------------------------------------------
+//---- ImageCache.c (C) 2026 Dave Gaunt                                                       ----
+//------------------------------------------------------------------------------------------------
+//---- Entries are a ring from the end of the firmware to the top of flash, each one a 4K     ----
+//---- header sector then the image, taking whole 64K blocks so it erases a block at a time.  ----
+//---- A new entry goes after the newest one, wrapping to the bottom when it won't fit, and   ----
+//---- anything it lands on is dropped. An entry matches when the name, size and FatFs        ----
+//---- timestamp agree with f_stat and the copy still has the CRC taken from the SD read when ----
+//---- it was cached. Reads go through the no-allocate XIP alias so streaming an image out    ----
+//---- doesn't evict the firmware from the XIP cache.                                         ----
+//------------------------------------------------------------------------------------------------
+
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/flash.h"
+#include "hardware/flash.h"
+#include "hardware/regs/addressmap.h"
+
+#include "ff.h"
+#include "ff_extent.h"
+#include "Crc32.h"
+#include "ImageCache.h"
+
+#define IMAGE_CACHE_BLOCK_SIZE		(65536)
+#define IMAGE_CACHE_DATA_OFFSET		(FLASH_SECTOR_SIZE)
+
+static_assert(sizeof(ImageCacheHeader) <= FLASH_PAGE_SIZE, "Header is written as a single page");
+
+extern char __flash_binary_end;
+
+typedef struct
+{
+	u32			m_uOffset;					// From The Start Of Flash
+	const u8*	m_pData;
+	u32			m_uLength;
+	bool		m_bErase;
+} ImageCacheOp;
+
+static u32 s_uCacheBase = PICO_FLASH_SIZE_BYTES;
+
+//------------------------------------------------------------------------------------------------
+//---- ImageCache_Data                                                                        ----
+//------------------------------------------------------------------------------------------------
+static inline const u8* ImageCache_Data(const u32 uOffset)
+{
+	return (const u8*)(XIP_NOCACHE_NOALLOC_BASE + uOffset + IMAGE_CACHE_DATA_OFFSET);
+}
+
+//------------------------------------------------------------------------------------------------
+//---- ImageCache_Next - First entry at or above *puOffset                                    ----
+//------------------------------------------------------------------------------------------------
+static const ImageCacheHeader* ImageCache_Next(u32* puOffset)
+{
+	for (u32 uOffset=*puOffset; uOffset<PICO_FLASH_SIZE_BYTES; uOffset+=IMAGE_CACHE_BLOCK_SIZE)
+	{
+		const ImageCacheHeader* pHeader = (const ImageCacheHeader*)(XIP_NOCACHE_NOALLOC_BASE + uOffset);
+
+		// Blocks Left Behind By A Dropped Entry Can Hold Anything, So The Extent Has To Make Sense Too
+		if ((IMAGE_CACHE_MAGIC == pHeader->m_uMagic) && (0 != pHeader->m_uSize) && (0 == (pHeader->m_uAllocated & (IMAGE_CACHE_BLOCK_SIZE - 1))) &&
+			(pHeader->m_uAllocated <= (PICO_FLASH_SIZE_BYTES - uOffset)) && (pHeader->m_uSize <= (pHeader->m_uAllocated - IMAGE_CACHE_DATA_OFFSET)))
+		{
+			*puOffset = uOffset;
+			return pHeader;
+		}
+	}
+
+	return NULL;
+}
+
+//------------------------------------------------------------------------------------------------
+//---- ImageCache_FlashOp - Runs with core 1 locked out and interrupts off                    ----
+//------------------------------------------------------------------------------------------------
+static void ImageCache_FlashOp(void* pParam)
+{
+	const ImageCacheOp* pOp = (const ImageCacheOp*)pParam;
+
+	if (pOp->m_bErase)
+		flash_range_erase(pOp->m_uOffset, pOp->m_uLength);
+	else
+		flash_range_program(pOp->m_uOffset, pOp->m_pData, pOp->m_uLength);
+}
+
+//------------------------------------------------------------------------------------------------
+//---- ImageCache_Flash                                                                       ----
+//------------------------------------------------------------------------------------------------
+static bool ImageCache_Flash(const u32 uOffset, const u8* pData, const u32 uLength, const bool bErase)
+{
+	ImageCacheOp op = { uOffset, pData, uLength, bErase };
+	return PICO_OK == flash_safe_execute(ImageCache_FlashOp, &op, UINT32_MAX);
+}
+
+//------------------------------------------------------------------------------------------------
+//---- ImageCache_Fill                                                                        ----
+//------------------------------------------------------------------------------------------------
+static bool ImageCache_Fill(const u32 uEntryOffset, const u32 uAllocated, const char* pszFileName, const FILINFO* pInfo, const u32 uSequence, u8* pBuffer, const u32 uBufferSize)
+{
+	const u32 uSize = (u32)pInfo->fsize;
+	u32 uCrc32 = 0;
+	FF_IMAGE image;
+
+	if (FR_OK != ff_image_open(&image, pszFileName))
+		return false;
+
+	// Header Block First, The Entry Stays Invalid Until The Very End
+	bool bFilled = ImageCache_Flash(uEntryOffset, NULL, IMAGE_CACHE_BLOCK_SIZE, true);
+
+	for (u32 uOffset=0; bFilled && (uOffset < uSize); uOffset += uBufferSize)
+	{
+		const u32 uDataOffset = uEntryOffset + IMAGE_CACHE_DATA_OFFSET + uOffset;
+		UINT uBytesRead;
+
+		if ((FR_OK != ff_image_read(&image, pBuffer, uOffset, uBufferSize, &uBytesRead)) || (0 == uBytesRead))
+		{
+			bFilled = false;
+			break;
+		}
+
+		// CRC What The Card Gave Us, Not What Ended Up In Flash
+		uCrc32 = Crc32(uCrc32, pBuffer, uBytesRead);
+
+		// Program Whole Sectors, The Tail Of The Last One Is Left Erased
+		const u32 uProgram = (uBytesRead + FLASH_SECTOR_SIZE - 1) & ~(FLASH_SECTOR_SIZE - 1);
+		memset(&pBuffer[uBytesRead], 0xFF, uProgram - uBytesRead);
+
+		for (u32 uBlock=uDataOffset & ~(IMAGE_CACHE_BLOCK_SIZE - 1); bFilled && (uBlock < (uDataOffset + uProgram)); uBlock += IMAGE_CACHE_BLOCK_SIZE)
+		{
+			if (uBlock >= uDataOffset)
+				bFilled = ImageCache_Flash(uBlock, NULL, IMAGE_CACHE_BLOCK_SIZE, true);
+		}
+
+		bFilled = bFilled && ImageCache_Flash(uDataOffset, pBuffer, uProgram, false);
+	}
+
+	ff_image_close(&image);
+
+	// Read It All Back Once, A Bad Program Must Never Get A Header
+	if (!bFilled || (uCrc32 != Crc32(0, ImageCache_Data(uEntryOffset), uSize)))
+		return false;
+
+	static ImageCacheHeader s_header __attribute__((aligned(4)));
+	static u8 s_aPage[FLASH_PAGE_SIZE] __attribute__((aligned(4)));
+
+	memset(&s_header, 0, sizeof(s_header));
+	s_header.m_uMagic = IMAGE_CACHE_MAGIC;
+	s_header.m_uSize = uSize;
+	s_header.m_uAllocated = uAllocated;
+	s_header.m_uCrc32 = uCrc32;
+	s_header.m_uSequence = uSequence;
+	s_header.m_uDate = pInfo->fdate;
+	s_header.m_uTime = pInfo->ftime;
+	strncpy(s_header.m_szName, pszFileName, IMAGE_CACHE_NAME_SIZE - 1);
+
+	memset(s_aPage, 0xFF, sizeof(s_aPage));
+	memcpy(s_aPage, &s_header, sizeof(s_header));
+	return ImageCache_Flash(uEntryOffset, s_aPage, sizeof(s_aPage), false);
+}
+
+//------------------------------------------------------------------------------------------------
+//---- ImageCache_Initialise                                                                  ----
+//------------------------------------------------------------------------------------------------
+void ImageCache_Initialise(void)
+{
+	const u32 uBinaryEnd = (u32)(uintptr_t)&__flash_binary_end - XIP_BASE;
+
+	s_uCacheBase = (uBinaryEnd + IMAGE_CACHE_BLOCK_SIZE - 1) & ~(IMAGE_CACHE_BLOCK_SIZE - 1);
+}
+
+//------------------------------------------------------------------------------------------------
+//---- ImageCache_Get                                                                         ----
+//------------------------------------------------------------------------------------------------
+const u8* ImageCache_Get(const char* pszFileName, u32* puSize, u8* pBuffer, const u32 uBufferSize)
+{
+	FILINFO info;
+
+	if ((s_uCacheBase >= PICO_FLASH_SIZE_BYTES) || (strlen(pszFileName) >= IMAGE_CACHE_NAME_SIZE))
+		return NULL;
+
+	// The Directory Entry Is All We Need From The Card To Know The Copy Is Current
+	if ((FR_OK != f_stat(pszFileName, &info)) || (0 == info.fsize) || (info.fsize > IMAGE_CACHE_MAX_IMAGE))
+		return NULL;
+
+	const u32 uAllocated = (IMAGE_CACHE_DATA_OFFSET + (u32)info.fsize + IMAGE_CACHE_BLOCK_SIZE - 1) & ~(IMAGE_CACHE_BLOCK_SIZE - 1);
+
+	if (uAllocated > (PICO_FLASH_SIZE_BYTES - s_uCacheBase))
+		return NULL;
+
+	const ImageCacheHeader* pHeader;
+	u32 uNext = s_uCacheBase;
+	u32 uNextSequence = 0;
+	u32 uEntryAllocated;
+
+	// Each Extent Is Taken Before The Header Might Be Erased Below
+	for (u32 uOffset=s_uCacheBase; NULL != (pHeader = ImageCache_Next(&uOffset)); uOffset += uEntryAllocated)
+	{
+		uEntryAllocated = pHeader->m_uAllocated;
+
+		if (pHeader->m_uSequence >= uNextSequence)
+		{
+			uNext = uOffset + uEntryAllocated;
+			uNextSequence = pHeader->m_uSequence + 1;
+		}
+
+		if ((pHeader->m_uSize == info.fsize) && (pHeader->m_uDate == info.fdate) && (pHeader->m_uTime == info.ftime) &&
+			(0 == strncmp(pHeader->m_szName, pszFileName, IMAGE_CACHE_NAME_SIZE)))
+		{
+			// FAT Times Are Only To 2 Seconds And Whatever The Host Set, So The Copy Has To Match Its CRC Too
+			if (Crc32(0, ImageCache_Data(uOffset), pHeader->m_uSize) == pHeader->m_uCrc32)
+			{
+				*puSize = pHeader->m_uSize;
+				return ImageCache_Data(uOffset);
+			}
+
+			// Drop It So The Next Get Doesn't Check It Again
+			if (!ImageCache_Flash(uOffset, NULL, FLASH_SECTOR_SIZE, true))
+				return NULL;
+		}
+	}
+
+	if ((uNext + uAllocated) > PICO_FLASH_SIZE_BYTES)
+		uNext = s_uCacheBase;
+
+	// Entries Starting Inside The New One Lose Their Header To The Fill, One Running Into It From Below Has To Go Now
+	for (u32 uOffset=s_uCacheBase; (uOffset < uNext) && (NULL != (pHeader = ImageCache_Next(&uOffset))); uOffset += pHeader->m_uAllocated)
+	{
+		if ((uOffset < uNext) && ((uOffset + pHeader->m_uAllocated) > uNext))
+		{
+			if (!ImageCache_Flash(uOffset, NULL, FLASH_SECTOR_SIZE, true))
+				return NULL;
+			break;
+		}
+	}
+
+	if (!ImageCache_Fill(uNext, uAllocated, pszFileName, &info, uNextSequence, pBuffer, uBufferSize))
+		return NULL;
+
+	*puSize = (u32)info.fsize;
+	return ImageCache_Data(uNext);
+}
@@ -0,0 +1,34 @@
+//------------------------------------------------------------------------------------------------
+//---- ImageCache.h (C) 2026 Dave Gaunt                                                       ----
+//------------------------------------------------------------------------------------------------
+//---- Copies Of SD Card Images Kept In The Top Of The Pico's Own QSPI Flash                  ----
+//------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "types.h"
+
+#define IMAGE_CACHE_MAGIC		(0x44474D49)		// "IMGD"
+#define IMAGE_CACHE_MAX_IMAGE	(2 << 20)			// Largest Flash IC We Program (M29F160)
+#define IMAGE_CACHE_NAME_SIZE	(48)
+
+// First Page Of Each Entry, Written Last So A Fill That Didn't Finish Never Matches.
+typedef struct
+{
+	u32		m_uMagic;
+	u32		m_uSize;
+	u32		m_uAllocated;					// Header Sector And Data, Rounded Up To 64K
+	u32		m_uCrc32;						// zlib CRC32 Of The Bytes Read From SD
+	u32		m_uSequence;					// Fill Order, The Newest Entry Is Followed By The Next
+	u16		m_uDate;						// FatFs fdate / ftime Of The File When Cached
+	u16		m_uTime;
+	char	m_szName[IMAGE_CACHE_NAME_SIZE];
+} ImageCacheHeader;
+
+// Finds The Flash Left Above The Firmware.
+void ImageCache_Initialise(void);
+
+// Returns The Image In XIP Flash, Only Its Directory Entry Is Read From SD If It Is Already Cached
+// And Unchanged. Otherwise It Is Copied From SD Through pBuffer (A Multiple Of 4K) Over The Oldest Entries.
+// NULL If The Image Can't Be Cached, The Caller Should Read It From SD Instead.
+const u8* ImageCache_Get(const char* pszFileName, u32* puSize, u8* pBuffer, const u32 uBufferSize);
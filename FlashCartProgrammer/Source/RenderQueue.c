@@ -0,0 +1,200 @@
+//------------------------------------------------------------------------------------------------
+//---- RenderQueue.c (C) 2026 Dave Gaunt                                                      ----
+//------------------------------------------------------------------------------------------------
+//---- Single producer (core 0), single consumer (core 1) ring. Core 0 only ever writes the   ----
+//---- head and core 1 only the tail, so no lock is needed - just a barrier between filling  ----
+//---- a slot and publishing it. Flash engines can post without disturbing bus timing, and   ----
+//---- core 1 sleeps on WFE until SEV says something was posted.                             ----
+//------------------------------------------------------------------------------------------------
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "hardware/sync.h"
+
+#include "vga111.h"
+#include "VgaText.h"
+#include "RenderQueue.h"
+
+static_assert(0 == (RENDER_QUEUE_SIZE & (RENDER_QUEUE_SIZE - 1)), "Queue size must be a power of 2");
+
+static RenderCommand s_aQueue[RENDER_QUEUE_SIZE];
+static volatile u32 s_uHead = 0;				// Written By Core 0 Only
+static volatile u32 s_uTail = 0;				// Written By Core 1 Only
+
+//------------------------------------------------------------------------------------------------
+//---- RenderQueue_Render                                                                     ----
+//------------------------------------------------------------------------------------------------
+static void RenderQueue_Render(const RenderCommand* pCommand)
+{
+	switch (pCommand->m_eCommand)
+	{
+		case RENDER_COMMAND_STRING:
+			VgaText_DrawString(pCommand->m_uCharX, pCommand->m_uCharY, pCommand->m_szString, pCommand->m_uColour);
+		break;
+
+		case RENDER_COMMAND_HEX_LINE:
+			FormatHexDumpLine(pCommand->m_uCharX, pCommand->m_uCharY, pCommand->m_hexLine.m_uAddress, pCommand->m_hexLine.m_aLine, pCommand->m_uColour, pCommand->m_hexLine.m_bASCII);
+		break;
+
+		case RENDER_COMMAND_PROGRESS:
+		{
+			// Pixel Bar Straight Into The Framebuffer, Nothing Else Draws Cells On That Row
+			const u32 uWidth = pCommand->m_progress.m_uWidth << 3;
+			const u32 uTotal = pCommand->m_progress.m_uTotal ? pCommand->m_progress.m_uTotal : 1;
+			const u32 uDone = (pCommand->m_progress.m_uDone < uTotal) ? pCommand->m_progress.m_uDone : uTotal;
+			const u32 uFilled = (u32)(((u64)uWidth * uDone) / uTotal);
+
+			vga_FilledRect(pCommand->m_uCharX << 3, (pCommand->m_uCharY << 3) + 1, uFilled, 6, pCommand->m_uColour);
+			vga_FilledRect((pCommand->m_uCharX << 3) + uFilled, (pCommand->m_uCharY << 3) + 1, uWidth - uFilled, 6, RGB111_BLACK);
+		}
+		break;
+
+		default:
+		break;
+	}
+}
+
+//------------------------------------------------------------------------------------------------
+//---- RenderQueue_Core1Main                                                                  ----
+//------------------------------------------------------------------------------------------------
+static void RenderQueue_Core1Main(void)
+{
+	// ImageCache Writes To Pico Flash Need Core 1 Parked Out Of XIP
+	multicore_lockout_victim_init();
+
+	while (true)
+	{
+		u32 uTail = s_uTail;
+
+		while (uTail != s_uHead)
+		{
+			// Read The Slot Only After Seeing The Head That Published It
+			__dmb();
+			RenderQueue_Render(&s_aQueue[uTail & (RENDER_QUEUE_SIZE - 1)]);
+			__dmb();
+			s_uTail = ++uTail;
+		}
+
+		VgaText_Flush();
+
+		if (uTail == s_uHead)
+			__wfe();
+	}
+}
+
+//------------------------------------------------------------------------------------------------
+//---- RenderQueue_Claim - Next free slot, or NULL if full and not waiting                   ----
+//------------------------------------------------------------------------------------------------
+static RenderCommand* RenderQueue_Claim(const bool bWait)
+{
+	while ((s_uHead - s_uTail) >= RENDER_QUEUE_SIZE)
+	{
+		if (!bWait)
+			return NULL;
+
+		tight_loop_contents();
+	}
+
+	return &s_aQueue[s_uHead & (RENDER_QUEUE_SIZE - 1)];
+}
+
+//------------------------------------------------------------------------------------------------
+//---- RenderQueue_Publish                                                                    ----
+//------------------------------------------------------------------------------------------------
+static void RenderQueue_Publish(void)
+{
+	// The Slot Must Be Visible To Core 1 Before The Head Moves Past It
+	__dmb();
+	s_uHead = s_uHead + 1;
+	__sev();
+}
+
+//------------------------------------------------------------------------------------------------
+//---- RenderQueue_Initialise                                                                 ----
+//------------------------------------------------------------------------------------------------
+void RenderQueue_Initialise(void)
+{
+	s_uHead = 0;
+	s_uTail = 0;
+	VgaText_Initialise();
+	multicore_launch_core1(RenderQueue_Core1Main);
+}
+
+//------------------------------------------------------------------------------------------------
+//---- RenderQueue_DrawString                                                                 ----
+//------------------------------------------------------------------------------------------------
+void RenderQueue_DrawString(const u32 uCharX, const u32 uCharY, const char* pszString, const u8 uColour)
+{
+	RenderCommand* pCommand = RenderQueue_Claim(true);
+
+	pCommand->m_eCommand = RENDER_COMMAND_STRING;
+	pCommand->m_uColour = uColour;
+	pCommand->m_uCharX = (u8)uCharX;
+	pCommand->m_uCharY = (u8)uCharY;
+	strncpy(pCommand->m_szString, pszString, RENDER_STRING_SIZE - 1);
+	pCommand->m_szString[RENDER_STRING_SIZE - 1] = 0;
+
+	RenderQueue_Publish();
+}
+
+//------------------------------------------------------------------------------------------------
+//---- RenderQueue_Printf - Formats straight into the slot, no temporary string              ----
+//------------------------------------------------------------------------------------------------
+void RenderQueue_Printf(const u32 uCharX, const u32 uCharY, const u8 uColour, const char* pszFormat, ...)
+{
+	RenderCommand* pCommand = RenderQueue_Claim(true);
+	va_list args;
+
+	pCommand->m_eCommand = RENDER_COMMAND_STRING;
+	pCommand->m_uColour = uColour;
+	pCommand->m_uCharX = (u8)uCharX;
+	pCommand->m_uCharY = (u8)uCharY;
+
+	va_start(args, pszFormat);
+	vsnprintf(pCommand->m_szString, RENDER_STRING_SIZE, pszFormat, args);
+	va_end(args);
+
+	RenderQueue_Publish();
+}
+
+//------------------------------------------------------------------------------------------------
+//---- RenderQueue_HexLine                                                                    ----
+//------------------------------------------------------------------------------------------------
+void RenderQueue_HexLine(const u32 uCharX, const u32 uCharY, const u32 uAddress, const u8* pLine, const u8 uColour, const bool bASCII)
+{
+	RenderCommand* pCommand = RenderQueue_Claim(true);
+
+	pCommand->m_eCommand = RENDER_COMMAND_HEX_LINE;
+	pCommand->m_uColour = uColour;
+	pCommand->m_uCharX = (u8)uCharX;
+	pCommand->m_uCharY = (u8)uCharY;
+	pCommand->m_hexLine.m_uAddress = uAddress;
+	memcpy(pCommand->m_hexLine.m_aLine, pLine, sizeof(pCommand->m_hexLine.m_aLine));
+	pCommand->m_hexLine.m_bASCII = bASCII;
+
+	RenderQueue_Publish();
+}
+
+//------------------------------------------------------------------------------------------------
+//---- RenderQueue_Progress                                                                   ----
+//------------------------------------------------------------------------------------------------
+void RenderQueue_Progress(const u32 uCharX, const u32 uCharY, const u32 uWidth, const u32 uDone, const u32 uTotal, const u8 uColour)
+{
+	RenderCommand* pCommand = RenderQueue_Claim(false);
+
+	if (NULL == pCommand)
+		return;
+
+	pCommand->m_eCommand = RENDER_COMMAND_PROGRESS;
+	pCommand->m_uColour = uColour;
+	pCommand->m_uCharX = (u8)uCharX;
+	pCommand->m_uCharY = (u8)uCharY;
+	pCommand->m_progress.m_uDone = uDone;
+	pCommand->m_progress.m_uTotal = uTotal;
+	pCommand->m_progress.m_uWidth = (u8)uWidth;
+
+	RenderQueue_Publish();
+}
@@ -0,0 +1,57 @@
+//------------------------------------------------------------------------------------------------
+//---- RenderQueue.h (C) 2026 Dave Gaunt                                                      ----
+//------------------------------------------------------------------------------------------------
+//---- Display Commands Posted From Core 0, Rendered Into The VgaText Cells By Core 1         ----
+//------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "types.h"
+
+#define RENDER_QUEUE_SIZE		(64)			// Commands, Power Of 2
+#define RENDER_STRING_SIZE		(80)			// A Full Row, Anything Longer Is Clipped Anyway
+
+enum render_command
+{
+	RENDER_COMMAND_STRING = 0,
+	RENDER_COMMAND_HEX_LINE,
+	RENDER_COMMAND_PROGRESS
+};
+
+typedef struct
+{
+	u8		m_eCommand;
+	u8		m_uColour;
+	u8		m_uCharX;
+	u8		m_uCharY;
+
+	union
+	{
+		char	m_szString[RENDER_STRING_SIZE];
+
+		struct
+		{
+			u32		m_uAddress;
+			u8		m_aLine[16];
+			u8		m_bASCII;
+		} m_hexLine;
+
+		struct
+		{
+			u32		m_uDone;
+			u32		m_uTotal;
+			u8		m_uWidth;				// Characters
+		} m_progress;
+	};
+} RenderCommand;
+
+// Clears The Cells And Starts The Render Loop On Core 1. From Here On Only Core 1 Touches VgaText.
+void RenderQueue_Initialise(void);
+
+// These Wait For Space If The Queue Is Full, Which Only Happens If Core 1 Falls A Long Way Behind.
+void RenderQueue_DrawString(const u32 uCharX, const u32 uCharY, const char* pszString, const u8 uColour);
+void RenderQueue_Printf(const u32 uCharX, const u32 uCharY, const u8 uColour, const char* pszFormat, ...) __attribute__((format(printf, 4, 5)));
+void RenderQueue_HexLine(const u32 uCharX, const u32 uCharY, const u32 uAddress, const u8* pLine, const u8 uColour, const bool bASCII);
+
+// Never Waits - Progress Is Dropped When The Queue Is Full, The Next Update Supersedes It Anyway.
+void RenderQueue_Progress(const u32 uCharX, const u32 uCharY, const u32 uWidth, const u32 uDone, const u32 uTotal, const u8 uColour);
@@ -0,0 +1,75 @@
+//------------------------------------------------------------------------------------------------
+//---- RomSparse.c (C) 2026 Dave Gaunt                                                        ----
+//------------------------------------------------------------------------------------------------
+//---- The file is a header, a table of extents in image order and then the data extents,     ----
+//---- each one starting on a 512 byte boundary so it can be read straight off the card.     ----
+//---- Holes have no bytes in the file at all.                                                ----
+//------------------------------------------------------------------------------------------------
+
+#include <assert.h>
+#include <string.h>
+
+#include "RomSparse.h"
+
+static_assert(sizeof(RomSparseHeader) == 16, "Must match HEADER in Tools/rom_sparse.py");
+static_assert(sizeof(RomSparseExtent) == 12, "Must match EXTENT in Tools/rom_sparse.py");
+static_assert(sizeof(RomSparseHeader) + (ROM_SPARSE_MAX_EXTENTS * sizeof(RomSparseExtent)) <= 4096, "Table must fit in the first SD read");
+
+//------------------------------------------------------------------------------------------------
+//---- RomSparse_IsSparse                                                                     ----
+//------------------------------------------------------------------------------------------------
+bool RomSparse_IsSparse(const u8* pData, const u32 uLength)
+{
+	RomSparseHeader header;
+
+	if (uLength < sizeof(header))
+		return false;
+
+	memcpy(&header, pData, sizeof(header));
+
+	return (ROM_SPARSE_MAGIC == header.m_uMagic) && (ROM_SPARSE_VERSION == header.m_uVersion);
+}
+
+//------------------------------------------------------------------------------------------------
+//---- RomSparse_LoadExtents                                                                  ----
+//------------------------------------------------------------------------------------------------
+u32 RomSparse_LoadExtents(const u8* pData, const u32 uLength, const u32 uFileSize, RomSparseExtent* pExtents, u32* puImageLength)
+{
+	if (!RomSparse_IsSparse(pData, uLength))
+		return 0;
+
+	RomSparseHeader header;
+	memcpy(&header, pData, sizeof(header));
+
+	const u32 uTableSize = header.m_uNumExtents * sizeof(RomSparseExtent);
+
+	if ((0 == header.m_uNumExtents) || (header.m_uNumExtents > ROM_SPARSE_MAX_EXTENTS) || ((sizeof(header) + uTableSize) > uLength))
+		return 0;
+
+	memcpy(pExtents, pData + sizeof(header), uTableSize);
+
+	// Extents Must Follow On From Each Other With No Gaps, Data Must Be Sector Aligned And In The File
+	u32 uNextOffset = 0;
+
+	for (u32 i=0; i<header.m_uNumExtents; ++i)
+	{
+		const RomSparseExtent* pExtent = &pExtents[i];
+
+		if ((pExtent->m_uOffset != uNextOffset) || (0 == pExtent->m_uLength) || (pExtent->m_uLength > (header.m_uLength - uNextOffset)))
+			return 0;
+
+		if (!RomSparse_IsHole(pExtent))
+		{
+			if ((0 != (pExtent->m_uFileOffset & (ROM_SPARSE_ALIGN - 1))) || (pExtent->m_uFileOffset > uFileSize) || (pExtent->m_uLength > (uFileSize - pExtent->m_uFileOffset)))
+				return 0;
+		}
+
+		uNextOffset += pExtent->m_uLength;
+	}
+
+	if (uNextOffset != header.m_uLength)
+		return 0;
+
+	*puImageLength = header.m_uLength;
+	return header.m_uNumExtents;
+}
@@ -0,0 +1,47 @@
+//------------------------------------------------------------------------------------------------
+//---- RomSparse.h (C) 2026 Dave Gaunt                                                        ----
+//------------------------------------------------------------------------------------------------
+//---- Sparse ROM Images, Data Extents Plus Erased Holes, See Tools/rom_sparse.py             ----
+//------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "types.h"
+
+#define ROM_SPARSE_MAGIC			(0x534D4F52)	// "ROMS"
+#define ROM_SPARSE_VERSION			(1)
+#define ROM_SPARSE_MAX_EXTENTS		(256)			// Header And Table Fit In The First 4K Of The File
+#define ROM_SPARSE_ALIGN			(512)			// Data Extents Start On An SD Sector
+#define ROM_SPARSE_HOLE				(0xFFFFFFFF)	// m_uFileOffset Of An Extent That Is All 0xFF
+
+typedef struct
+{
+	u32		m_uMagic;
+	u16		m_uVersion;
+	u16		m_uNumExtents;
+	u32		m_uLength;						// Size Of The Full Image, Holes Included
+	u32		m_uReserved;
+} RomSparseHeader;
+
+typedef struct
+{
+	u32		m_uOffset;						// Into The Full Image
+	u32		m_uLength;
+	u32		m_uFileOffset;					// Into The Sparse File, Or ROM_SPARSE_HOLE
+} RomSparseExtent;
+
+// True If pData Starts With A Sparse Image Header.
+bool RomSparse_IsSparse(const u8* pData, const u32 uLength);
+
+// Copies The Extent Table Out Of pData, Which Must Hold At Least The Header And Table, And Checks
+// The Extents Tile The Image In Order And Their Data Lies Within uFileSize. Returns The Number Of
+// Extents, Or 0 If The Table Is Bad.
+u32 RomSparse_LoadExtents(const u8* pData, const u32 uLength, const u32 uFileSize, RomSparseExtent* pExtents, u32* puImageLength);
+
+//------------------------------------------------------------------------------------------------
+//---- RomSparse_IsHole                                                                       ----
+//------------------------------------------------------------------------------------------------
+static inline bool RomSparse_IsHole(const RomSparseExtent* pExtent)
+{
+	return (ROM_SPARSE_HOLE == pExtent->m_uFileOffset);
+}
@@ -0,0 +1,355 @@
+//------------------------------------------------------------------------------------------------
+//---- RomTransform.c (C) 2026 Dave Gaunt                                                     ----
+//------------------------------------------------------------------------------------------------
+//---- Each buffer the reader produces is pushed through the stages once. Byte swap and       ----
+//---- deinterleave rewrite it in place a word at a time, relocate and mirror only change     ----
+//---- where it lands, so a 256K Kickstart mirrored into 512K is read from SD once and        ----
+//---- programmed twice. Padding is never written, it is 0xFF and only has to be blank.       ----
+//------------------------------------------------------------------------------------------------
+
+#include <stddef.h>
+
+#include "RomTransform.h"
+
+//------------------------------------------------------------------------------------------------
+//---- RomTransform_ByteSwap16                                                                ----
+//------------------------------------------------------------------------------------------------
+void RomTransform_ByteSwap16(u8* pData, const u32 uLength)
+{
+	u32* pWords = (u32*)pData;
+	const u32 uNumWords = uLength >> 2;
+
+	// Compiles To REV16, Two Halfwords Per Instruction
+	for (u32 i=0; i<uNumWords; ++i)
+	{
+		const u32 uWord = pWords[i];
+		pWords[i] = ((uWord & 0x00FF00FF) << 8) | ((uWord >> 8) & 0x00FF00FF);
+	}
+
+	if (uLength & 2)
+	{
+		u16* pHalf = (u16*)&pWords[uNumWords];
+		*pHalf = swap_u16(*pHalf);
+	}
+}
+
+//------------------------------------------------------------------------------------------------
+//---- RomTransform_Deinterleave                                                              ----
+//------------------------------------------------------------------------------------------------
+void RomTransform_Deinterleave(u8* pData, const u32 uLength, const u32 uWidth, const u32 uLane, const u32 uCount)
+{
+	const u32 uStride = uWidth * uCount;
+	const u32 uNumGroups = uLength / uStride;
+
+	if ((2 == uWidth) && (2 == uCount))
+	{
+		// 16 Bit Halves Of A 32 Bit Image, Lane 0 Is The First Word In The File
+		const u32* pIn = (const u32*)pData;
+		u16* pOut = (u16*)pData;
+		const u32 uShift = uLane << 4;
+
+		for (u32 i=0; i<uNumGroups; ++i)
+			pOut[i] = (u16)(pIn[i] >> uShift);
+
+		return;
+	}
+
+	if ((1 == uWidth) && (2 == uCount))
+	{
+		// Even Or Odd Bytes For A Pair Of 8 Bit Chips
+		const u16* pIn = (const u16*)pData;
+		const u32 uShift = uLane << 3;
+
+		for (u32 i=0; i<uNumGroups; ++i)
+			pData[i] = (u8)(pIn[i] >> uShift);
+
+		return;
+	}
+
+	// Anything Else, A Byte At A Time. The Output Never Overtakes The Input.
+	const u8* pIn = pData + (uLane * uWidth);
+	u8* pOut = pData;
+
+	for (u32 i=0; i<uNumGroups; ++i, pIn += uStride)
+	{
+		for (u32 j=0; j<uWidth; ++j)
+			*pOut++ = pIn[j];
+	}
+}
+
+//------------------------------------------------------------------------------------------------
+//---- RomPipeline_Initialise                                                                 ----
+//------------------------------------------------------------------------------------------------
+void RomPipeline_Initialise(RomPipeline* pPipeline, RomPipelineProgram pfnProgram, RomPipelineBlank pfnBlank, RomPipelineProgress pfnProgress)
+{
+	pPipeline->m_pfnProgram = pfnProgram;
+	pPipeline->m_pfnBlank = pfnBlank;
+	pPipeline->m_pfnProgress = pfnProgress;
+	pPipeline->m_uImageLength = 0;
+	pPipeline->m_uNumStages = 0;
+	pPipeline->m_bMirrored = false;
+}
+
+//------------------------------------------------------------------------------------------------
+//---- RomPipeline_Add                                                                        ----
+//------------------------------------------------------------------------------------------------
+static RomTransform* RomPipeline_Add(RomPipeline* pPipeline, const u8 eType, const bool bChangesData)
+{
+	if ((pPipeline->m_uNumStages >= ROM_PIPELINE_MAX_STAGES) || (bChangesData && pPipeline->m_bMirrored))
+		return NULL;
+
+	RomTransform* pStage = &pPipeline->m_aStages[pPipeline->m_uNumStages++];
+	pStage->m_eType = eType;
+	pStage->m_uWidth = 0;
+	pStage->m_uLane = 0;
+	pStage->m_uCount = 0;
+	pStage->m_uParam = 0;
+	pStage->m_uLength = 0;
+	return pStage;
+}
+
+//------------------------------------------------------------------------------------------------
+//---- RomPipeline_AddByteSwap16                                                              ----
+//------------------------------------------------------------------------------------------------
+bool RomPipeline_AddByteSwap16(RomPipeline* pPipeline)
+{
+	return (NULL != RomPipeline_Add(pPipeline, ROM_TRANSFORM_BYTESWAP16, true));
+}
+
+//------------------------------------------------------------------------------------------------
+//---- RomPipeline_AddDeinterleave                                                            ----
+//------------------------------------------------------------------------------------------------
+bool RomPipeline_AddDeinterleave(RomPipeline* pPipeline, const u32 uWidth, const u32 uLane, const u32 uCount)
+{
+	const u32 uStride = uWidth * uCount;
+
+	// Buffers Are Powers Of Two, So A Group That Isn't One Would Straddle Them
+	if ((0 == uWidth) || (uWidth > 4) || (uCount < 2) || (uCount > 8) || (uLane >= uCount) || (0 != (uStride & (uStride - 1))))
+		return false;
+
+	RomTransform* pStage = RomPipeline_Add(pPipeline, ROM_TRANSFORM_DEINTERLEAVE, true);
+	if (NULL == pStage)
+		return false;
+
+	pStage->m_uWidth = uWidth;
+	pStage->m_uLane = uLane;
+	pStage->m_uCount = uCount;
+	return true;
+}
+
+//------------------------------------------------------------------------------------------------
+//---- RomPipeline_AddRelocate                                                                ----
+//------------------------------------------------------------------------------------------------
+bool RomPipeline_AddRelocate(RomPipeline* pPipeline, const u32 uOffset)
+{
+	RomTransform* pStage = RomPipeline_Add(pPipeline, ROM_TRANSFORM_RELOCATE, false);
+	if (NULL == pStage)
+		return false;
+
+	pStage->m_uParam = uOffset;
+	return true;
+}
+
+//------------------------------------------------------------------------------------------------
+//---- RomPipeline_AddMirror                                                                  ----
+//------------------------------------------------------------------------------------------------
+bool RomPipeline_AddMirror(RomPipeline* pPipeline, const u32 uSize)
+{
+	RomTransform* pStage = RomPipeline_Add(pPipeline, ROM_TRANSFORM_MIRROR, false);
+	if (NULL == pStage)
+		return false;
+
+	pStage->m_uParam = uSize;
+	pPipeline->m_bMirrored = true;
+	return true;
+}
+
+//------------------------------------------------------------------------------------------------
+//---- RomPipeline_AddPad                                                                     ----
+//------------------------------------------------------------------------------------------------
+bool RomPipeline_AddPad(RomPipeline* pPipeline, const u32 uAlign)
+{
+	if (0 == uAlign)
+		return false;
+
+	RomTransform* pStage = RomPipeline_Add(pPipeline, ROM_TRANSFORM_PAD, false);
+	if (NULL == pStage)
+		return false;
+
+	pStage->m_uParam = uAlign;
+	return true;
+}
+
+//------------------------------------------------------------------------------------------------
+//---- RomPipeline_Begin                                                                      ----
+//------------------------------------------------------------------------------------------------
+bool RomPipeline_Begin(RomPipeline* pPipeline, const u32 uImageLength)
+{
+	u32 uLength = uImageLength;
+	bool bWords = false;
+
+	pPipeline->m_uImageLength = uImageLength;
+
+	for (u32 uStage=0; uStage<pPipeline->m_uNumStages; ++uStage)
+	{
+		RomTransform* pStage = &pPipeline->m_aStages[uStage];
+		pStage->m_uLength = uLength;
+
+		// Once Swapped To 16 Bit Words A Stray Byte Can't Be Programmed, So Refuse It Up Front
+		if (bWords && (uLength & 1))
+			return false;
+
+		switch (pStage->m_eType)
+		{
+			case ROM_TRANSFORM_BYTESWAP16:
+				bWords = true;
+			break;
+
+			case ROM_TRANSFORM_DEINTERLEAVE:
+			{
+				if (0 != (uLength % (pStage->m_uWidth * pStage->m_uCount)))
+					return false;
+
+				uLength /= pStage->m_uCount;
+			}
+			break;
+
+			case ROM_TRANSFORM_MIRROR:
+			{
+				if ((0 == uLength) || (pStage->m_uParam < uLength) || (0 != (pStage->m_uParam % uLength)))
+					return false;
+
+				uLength = pStage->m_uParam;
+			}
+			break;
+
+			case ROM_TRANSFORM_RELOCATE:
+			{
+				if (bWords && (pStage->m_uParam & 1))
+					return false;
+			}
+			break;
+
+			case ROM_TRANSFORM_PAD:
+				uLength = ((uLength + pStage->m_uParam - 1) / pStage->m_uParam) * pStage->m_uParam;
+			break;
+
+			default:
+			break;
+		}
+	}
+
+	return !(bWords && (uLength & 1));
+}
+
+//------------------------------------------------------------------------------------------------
+//---- RomPipeline_Run - pData NULL for a blank run                                           ----
+//------------------------------------------------------------------------------------------------
+static bool RomPipeline_Run(RomPipeline* pPipeline, u32 uStage, u8* pData, u32 uOffset, u32 uLength)
+{
+	for (; uStage<pPipeline->m_uNumStages; ++uStage)
+	{
+		const RomTransform* pStage = &pPipeline->m_aStages[uStage];
+
+		switch (pStage->m_eType)
+		{
+			case ROM_TRANSFORM_BYTESWAP16:
+			{
+				if (NULL != pData)
+					RomTransform_ByteSwap16(pData, uLength);
+			}
+			break;
+
+			case ROM_TRANSFORM_DEINTERLEAVE:
+			{
+				if (NULL != pData)
+					RomTransform_Deinterleave(pData, uLength, pStage->m_uWidth, pStage->m_uLane, pStage->m_uCount);
+
+				uOffset /= pStage->m_uCount;
+				uLength /= pStage->m_uCount;
+			}
+			break;
+
+			case ROM_TRANSFORM_RELOCATE:
+				uOffset += pStage->m_uParam;
+			break;
+
+			case ROM_TRANSFORM_MIRROR:
+			{
+				// The Rest Of The Pipeline Only Moves Addresses, So The Same Buffer Goes To Every Copy
+				for (u32 uCopy=0; uCopy<pStage->m_uParam; uCopy += pStage->m_uLength)
+				{
+					if (!RomPipeline_Run(pPipeline, uStage + 1, pData, uOffset + uCopy, uLength))
+						return false;
+				}
+			}
+			return true;
+
+			default:
+			break;
+		}
+	}
+
+	if (0 == uLength)
+		return true;
+
+	if (NULL == pData)
+		return pPipeline->m_pfnBlank(uOffset, uLength);
+
+	return pPipeline->m_pfnProgram(pData, uOffset, uLength);
+}
+
+//------------------------------------------------------------------------------------------------
+//---- RomPipeline_Progress                                                                   ----
+//------------------------------------------------------------------------------------------------
+static inline void RomPipeline_Progress(const RomPipeline* pPipeline, const u32 uImageOffset, const u32 uLength)
+{
+	if (NULL != pPipeline->m_pfnProgress)
+		pPipeline->m_pfnProgress(uImageOffset + uLength, pPipeline->m_uImageLength);
+}
+
+//------------------------------------------------------------------------------------------------
+//---- RomPipeline_Write                                                                      ----
+//------------------------------------------------------------------------------------------------
+bool RomPipeline_Write(RomPipeline* pPipeline, u8* pData, const u32 uImageOffset, const u32 uLength)
+{
+	if (!RomPipeline_Run(pPipeline, 0, pData, uImageOffset, uLength))
+		return false;
+
+	RomPipeline_Progress(pPipeline, uImageOffset, uLength);
+	return true;
+}
+
+//------------------------------------------------------------------------------------------------
+//---- RomPipeline_Blank                                                                      ----
+//------------------------------------------------------------------------------------------------
+bool RomPipeline_Blank(RomPipeline* pPipeline, const u32 uImageOffset, const u32 uLength)
+{
+	if (!RomPipeline_Run(pPipeline, 0, NULL, uImageOffset, uLength))
+		return false;
+
+	RomPipeline_Progress(pPipeline, uImageOffset, uLength);
+	return true;
+}
+
+//------------------------------------------------------------------------------------------------
+//---- RomPipeline_Finish                                                                     ----
+//------------------------------------------------------------------------------------------------
+bool RomPipeline_Finish(RomPipeline* pPipeline)
+{
+	for (u32 uStage=0; uStage<pPipeline->m_uNumStages; ++uStage)
+	{
+		const RomTransform* pStage = &pPipeline->m_aStages[uStage];
+
+		if (ROM_TRANSFORM_PAD != pStage->m_eType)
+			continue;
+
+		// Padding Enters The Stream Here, So Only The Stages After This One See It
+		const u32 uPadded = ((pStage->m_uLength + pStage->m_uParam - 1) / pStage->m_uParam) * pStage->m_uParam;
+
+		if ((uPadded > pStage->m_uLength) && !RomPipeline_Run(pPipeline, uStage + 1, NULL, pStage->m_uLength, uPadded - pStage->m_uLength))
+			return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,74 @@
+//------------------------------------------------------------------------------------------------
+//---- RomTransform.h (C) 2026 Dave Gaunt                                                     ----
+//------------------------------------------------------------------------------------------------
+//---- Streaming Transform Stages Between The Image Reader And The Flash Writer               ----
+//------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "types.h"
+
+#define ROM_PIPELINE_MAX_STAGES		(8)
+
+enum rom_transform
+{
+	ROM_TRANSFORM_BYTESWAP16 = 0,			// Swap The Bytes Of Each 16 Bit Word
+	ROM_TRANSFORM_DEINTERLEAVE,				// Keep One Lane Of Every Group, One Chip Of A Split Pair
+	ROM_TRANSFORM_RELOCATE,					// Move The Stream To Another Flash Address
+	ROM_TRANSFORM_MIRROR,					// Repeat The Stream Until It Fills A Size
+	ROM_TRANSFORM_PAD						// Blank Check Up To The Next Multiple Of A Size
+};
+
+typedef struct
+{
+	u8		m_eType;
+	u8		m_uWidth;						// Deinterleave Unit In Bytes
+	u8		m_uLane;
+	u8		m_uCount;						// Lanes Per Group
+	u32		m_uParam;						// Relocate Offset, Mirror Size Or Pad Alignment
+	u32		m_uLength;						// Stream Length Coming Into This Stage, Set By Begin
+} RomTransform;
+
+// pData Is In Its Final Bus Order. Progress Is In Image Bytes, Once Per Write Or Blank However
+// Many Copies Of It A Mirror Makes.
+typedef bool (*RomPipelineProgram)(const u8* pData, const u32 uRomOffset, const u32 uLength);
+typedef bool (*RomPipelineBlank)(const u32 uRomOffset, const u32 uLength);
+typedef void (*RomPipelineProgress)(const u32 uDone, const u32 uTotal);
+
+typedef struct
+{
+	RomPipelineProgram	m_pfnProgram;
+	RomPipelineBlank	m_pfnBlank;
+	RomPipelineProgress	m_pfnProgress;			// May Be NULL
+	u32					m_uImageLength;
+	u32					m_uNumStages;
+	bool				m_bMirrored;		// Stages That Change The Data Must Come Before Any Mirror
+	RomTransform		m_aStages[ROM_PIPELINE_MAX_STAGES];
+} RomPipeline;
+
+void RomPipeline_Initialise(RomPipeline* pPipeline, RomPipelineProgram pfnProgram, RomPipelineBlank pfnBlank, RomPipelineProgress pfnProgress);
+
+// Stages Run In The Order They Are Added. Each Returns False If The Pipeline Is Full Or The Stage
+// Would Change Data After A Mirror, Which Has Already Sent The Buffer More Than Once. Deinterleave
+// Groups Must Be A Power Of Two So Every Buffer Starts On One.
+bool RomPipeline_AddByteSwap16(RomPipeline* pPipeline);
+bool RomPipeline_AddDeinterleave(RomPipeline* pPipeline, const u32 uWidth, const u32 uLane, const u32 uCount);
+bool RomPipeline_AddRelocate(RomPipeline* pPipeline, const u32 uOffset);
+bool RomPipeline_AddMirror(RomPipeline* pPipeline, const u32 uSize);
+bool RomPipeline_AddPad(RomPipeline* pPipeline, const u32 uAlign);
+
+// Works Out Each Stage's Stream Length, False If A Mirror Or Deinterleave Doesn't Divide Evenly,
+// Or If An Odd Length Or Relocate Follows A 16 Bit Byte Swap.
+bool RomPipeline_Begin(RomPipeline* pPipeline, const u32 uImageLength);
+
+// pData Is Transformed In Place, So Must Be RAM, 4 Byte Aligned, And Start On A Deinterleave Group.
+bool RomPipeline_Write(RomPipeline* pPipeline, u8* pData, const u32 uImageOffset, const u32 uLength);
+
+// A Run Of The Image Known To Be 0xFF, Only Blank Checked Wherever It Lands.
+bool RomPipeline_Blank(RomPipeline* pPipeline, const u32 uImageOffset, const u32 uLength);
+
+// Blank Checks The Padding.
+bool RomPipeline_Finish(RomPipeline* pPipeline);
+
+void RomTransform_ByteSwap16(u8* pData, const u32 uLength);
+void RomTransform_Deinterleave(u8* pData, const u32 uLength, const u32 uWidth, const u32 uLane, const u32 uCount);
@@ -0,0 +1,150 @@
+//------------------------------------------------------------------------------------------------
+//---- RomUnpack.c (C) 2026 Dave Gaunt                                                        ----
+//------------------------------------------------------------------------------------------------
+//---- The stream after the header is plain heatshrink: a 1 bit tag, then either an 8 bit     ----
+//---- literal or a back reference of (offset - 1) in window bits and (count - 1) in          ----
+//---- lookahead bits, all MSB first. Only the window is kept, so RAM use doesn't depend on   ----
+//---- the image size and any amount can be pulled out at a time to suit the flash blocks.    ----
+//------------------------------------------------------------------------------------------------
+
+#include <assert.h>
+#include <string.h>
+
+#include "Crc32.h"
+#include "RomUnpack.h"
+
+static_assert(sizeof(RomPackHeader) == 16, "Must match HEADER in Tools/rom_pack.py");
+
+//------------------------------------------------------------------------------------------------
+//---- RomUnpack_GetBits                                                                      ----
+//------------------------------------------------------------------------------------------------
+static u32 RomUnpack_GetBits(RomUnpack* pUnpack, const u32 uCount)
+{
+	while (pUnpack->m_uNumBits < uCount)
+	{
+		if (pUnpack->m_pInput >= pUnpack->m_pInputEnd)
+		{
+			const u32 uRefilled = (NULL != pUnpack->m_pfnRefill) ? pUnpack->m_pfnRefill(pUnpack->m_pContext, &pUnpack->m_pInput) : 0;
+
+			if (0 == uRefilled)
+			{
+				// Packed Data Ended Before The Header Said It Would
+				pUnpack->m_bError = true;
+				return 0;
+			}
+
+			pUnpack->m_pInputEnd = pUnpack->m_pInput + uRefilled;
+		}
+
+		pUnpack->m_uBits = (pUnpack->m_uBits << 8) | *pUnpack->m_pInput++;
+		pUnpack->m_uNumBits += 8;
+	}
+
+	pUnpack->m_uNumBits -= uCount;
+	return (pUnpack->m_uBits >> pUnpack->m_uNumBits) & ((1 << uCount) - 1);
+}
+
+//------------------------------------------------------------------------------------------------
+//---- RomUnpack_IsPacked                                                                     ----
+//------------------------------------------------------------------------------------------------
+bool RomUnpack_IsPacked(const u8* pData, const u32 uLength)
+{
+	RomPackHeader header;
+
+	if (uLength < sizeof(header))
+		return false;
+
+	memcpy(&header, pData, sizeof(header));
+
+	return (ROM_PACK_MAGIC == header.m_uMagic) && (ROM_PACK_VERSION == header.m_uVersion) &&
+		   (header.m_uWindowBits >= 4) && (header.m_uWindowBits <= ROM_UNPACK_MAX_WINDOW_BITS) &&
+		   (header.m_uLookaheadBits >= 3) && (header.m_uLookaheadBits < header.m_uWindowBits);
+}
+
+//------------------------------------------------------------------------------------------------
+//---- RomUnpack_Begin                                                                        ----
+//------------------------------------------------------------------------------------------------
+bool RomUnpack_Begin(RomUnpack* pUnpack, const u8* pInput, const u32 uInputLength, RomUnpackRefill pfnRefill, void* pContext)
+{
+	if (!RomUnpack_IsPacked(pInput, uInputLength))
+		return false;
+
+	RomPackHeader header;
+	memcpy(&header, pInput, sizeof(header));
+
+	pUnpack->m_pInput = pInput + sizeof(header);
+	pUnpack->m_pInputEnd = pInput + uInputLength;
+	pUnpack->m_pfnRefill = pfnRefill;
+	pUnpack->m_pContext = pContext;
+
+	pUnpack->m_uBits = 0;
+	pUnpack->m_uNumBits = 0;
+	pUnpack->m_uMatchLeft = 0;
+	pUnpack->m_uMatchOffset = 0;
+	pUnpack->m_uWindowPos = 0;
+	pUnpack->m_uWindowMask = (1 << header.m_uWindowBits) - 1;
+	pUnpack->m_uLength = header.m_uLength;
+	pUnpack->m_uLeft = header.m_uLength;
+	pUnpack->m_uCrc32 = 0;
+	pUnpack->m_uExpectedCrc32 = header.m_uCrc32;
+	pUnpack->m_uWindowBits = header.m_uWindowBits;
+	pUnpack->m_uLookaheadBits = header.m_uLookaheadBits;
+	pUnpack->m_bError = false;
+
+	// heatshrink Starts With A Zeroed Window, References Before The Start Read Zeros
+	memset(pUnpack->m_aWindow, 0, sizeof(pUnpack->m_aWindow));
+	return true;
+}
+
+//------------------------------------------------------------------------------------------------
+//---- RomUnpack_Read                                                                         ----
+//------------------------------------------------------------------------------------------------
+u32 RomUnpack_Read(RomUnpack* pUnpack, u8* pDest, const u32 uSpace)
+{
+	const u32 uWindowMask = pUnpack->m_uWindowMask;
+	u32 uWritten = 0;
+
+	while ((uWritten < uSpace) && (0 != pUnpack->m_uLeft))
+	{
+		u8 uByte;
+
+		if (0 != pUnpack->m_uMatchLeft)
+		{
+			// Read Before Write, An Offset Of The Full Window Size Is The Oldest Byte
+			uByte = pUnpack->m_aWindow[(pUnpack->m_uWindowPos - pUnpack->m_uMatchOffset) & uWindowMask];
+			--pUnpack->m_uMatchLeft;
+		}
+		else if (RomUnpack_GetBits(pUnpack, 1))
+		{
+			uByte = (u8)RomUnpack_GetBits(pUnpack, 8);
+		}
+		else
+		{
+			pUnpack->m_uMatchOffset = RomUnpack_GetBits(pUnpack, pUnpack->m_uWindowBits) + 1;
+			pUnpack->m_uMatchLeft = RomUnpack_GetBits(pUnpack, pUnpack->m_uLookaheadBits) + 1;
+
+			if (pUnpack->m_bError)
+				break;
+
+			continue;
+		}
+
+		if (pUnpack->m_bError)
+			break;
+
+		pUnpack->m_aWindow[pUnpack->m_uWindowPos++ & uWindowMask] = uByte;
+		pDest[uWritten++] = uByte;
+		--pUnpack->m_uLeft;
+	}
+
+	pUnpack->m_uCrc32 = Crc32(pUnpack->m_uCrc32, pDest, uWritten);
+	return uWritten;
+}
+
+//------------------------------------------------------------------------------------------------
+//---- RomUnpack_Finish                                                                       ----
+//------------------------------------------------------------------------------------------------
+bool RomUnpack_Finish(const RomUnpack* pUnpack)
+{
+	return !pUnpack->m_bError && (0 == pUnpack->m_uLeft) && (pUnpack->m_uCrc32 == pUnpack->m_uExpectedCrc32);
+}
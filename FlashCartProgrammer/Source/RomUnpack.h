@@ -0,0 +1,69 @@
+//------------------------------------------------------------------------------------------------
+//---- RomUnpack.h (C) 2026 Dave Gaunt                                                        ----
+//------------------------------------------------------------------------------------------------
+//---- Streaming heatshrink Decoder For Packed ROM Images, See Tools/rom_pack.py              ----
+//------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "types.h"
+
+#define ROM_PACK_MAGIC				(0x5A4D4F52)	// "ROMZ"
+#define ROM_PACK_VERSION			(1)
+#define ROM_UNPACK_MAX_WINDOW_BITS	(12)			// 4K History, The Only RAM The Decoder Needs
+
+typedef struct
+{
+	u32		m_uMagic;
+	u8		m_uVersion;
+	u8		m_uWindowBits;					// heatshrink -w
+	u8		m_uLookaheadBits;				// heatshrink -l
+	u8		m_uReserved;
+	u32		m_uLength;						// Unpacked Size
+	u32		m_uCrc32;						// zlib CRC32 Of The Unpacked Bytes
+} RomPackHeader;
+
+// Called When The Input Runs Dry, Points *ppInput At The Next Packed Bytes And Returns How Many.
+typedef u32 (*RomUnpackRefill)(void* pContext, const u8** ppInput);
+
+typedef struct
+{
+	const u8*		m_pInput;
+	const u8*		m_pInputEnd;
+	RomUnpackRefill	m_pfnRefill;
+	void*			m_pContext;
+
+	u32		m_uBits;						// MSB First Bit Reservoir
+	u32		m_uNumBits;
+	u32		m_uMatchLeft;					// Bytes Left In The Current Back Reference
+	u32		m_uMatchOffset;
+	u32		m_uWindowPos;
+	u32		m_uWindowMask;
+	u32		m_uLength;						// From The Header
+	u32		m_uLeft;						// Unpacked Bytes Still To Come
+	u32		m_uCrc32;						// Running, Of What Has Been Unpacked So Far
+	u32		m_uExpectedCrc32;
+	u8		m_uWindowBits;
+	u8		m_uLookaheadBits;
+	bool	m_bError;
+
+	u8		m_aWindow[1 << ROM_UNPACK_MAX_WINDOW_BITS];
+} RomUnpack;
+
+// True If pData Starts With A Packed Image Header This Decoder Can Handle.
+bool RomUnpack_IsPacked(const u8* pData, const u32 uLength);
+
+// pInput Is The Start Of The Packed File, Header Included. pfnRefill May Be NULL If It Is All There.
+bool RomUnpack_Begin(RomUnpack* pUnpack, const u8* pInput, const u32 uInputLength, RomUnpackRefill pfnRefill, void* pContext);
+
+// Unpacked Size From The Header.
+static inline u32 RomUnpack_GetLength(const RomUnpack* pUnpack)
+{
+	return pUnpack->m_uLength;
+}
+
+// Unpacks Up To uSpace Bytes, Returns Fewer Only At The End Of The Image Or If The Input Runs Out.
+u32 RomUnpack_Read(RomUnpack* pUnpack, u8* pDest, const u32 uSpace);
+
+// True If Every Byte Was Unpacked And The CRC32 Matches The Header.
+bool RomUnpack_Finish(const RomUnpack* pUnpack);
@@ -0,0 +1,119 @@
+//------------------------------------------------------------------------------------------------
+//---- VgaText.c (C) 2026 Dave Gaunt                                                          ----
+//------------------------------------------------------------------------------------------------
+//---- A shadow copy of what has been drawn is kept, so rewriting a status line or hex dump   ----
+//---- with mostly the same text only rasterises the handful of cells that actually changed. ----
+//------------------------------------------------------------------------------------------------
+
+#include <string.h>
+
+#include "VgaText.h"
+
+u8 g_aTextChar[VGA_TEXT_ROWS][VGA_TEXT_COLUMNS];
+u8 g_aTextColour[VGA_TEXT_ROWS][VGA_TEXT_COLUMNS];
+u64 g_uTextDirtyRows = 0;
+
+static u8 s_aDrawnChar[VGA_TEXT_ROWS][VGA_TEXT_COLUMNS];
+static u8 s_aDrawnColour[VGA_TEXT_ROWS][VGA_TEXT_COLUMNS];
+
+//------------------------------------------------------------------------------------------------
+//---- ascii_to_petscii                                                                       ----
+//------------------------------------------------------------------------------------------------
+u8 ascii_to_petscii(const u8 c)
+{
+    // Handle ASCII Lowercase (97-122) Maps 'a'-'z' to ROM Lowwercase (1-26)
+    if (c >= 97 && c <= 122)
+		return c - 96;
+
+    // Special Case For '@'
+    if (c == 64)
+		return 0;
+
+    // Handle Space (32) through 'Z' (90)
+	// This includes numbers and maps ASCII Uppercase (65-90) to ROM Uppercase (65-90)
+    if (c >= 32 && c <= 90)
+		return c;
+
+    // Default to Space
+    return 32; 
+}
+
+//------------------------------------------------------------------------------------------------
+//---- FormatHexDumpLine	                                                                  ----
+//------------------------------------------------------------------------------------------------
+void FormatHexDumpLine(u32 uCharX, u32 uCharY, const u32 uAddress, const u8* pLineBuffer, const u8 uColour, const bool bASCII)
+{
+	// Write Address Offset in 6 byte hex.
+	for(int i=5; i>=0; --i)
+		VgaText_PutChar(uCharX + 5 - i, uCharY, g_aHexTable[(uAddress >> (i << 2)) & 15], uColour);
+
+	// Write 16 bytes worth of hex values.
+ 	for(u32 uIndex=0; uIndex<16; ++uIndex)
+	{
+    	const u16 uHexPair = byteToHex(pLineBuffer[uIndex]);
+		VgaText_PutChar(uCharX + 8 + (uIndex * 3), uCharY, uHexPair >> 8, uColour);
+		VgaText_PutChar(uCharX + 9 + (uIndex * 3), uCharY, uHexPair & 255, uColour);
+
+		// Write ASCII or PETSCII version of byte.
+		const u8 uCurrentChar = (bASCII) ? ascii_to_petscii(pLineBuffer[uIndex]) : pLineBuffer[uIndex];
+		VgaText_PutChar(uCharX + 57 + uIndex, uCharY, uCurrentChar, uColour);
+	}
+}
+
+//------------------------------------------------------------------------------------------------
+//---- VgaText_Initialise                                                                     ----
+//------------------------------------------------------------------------------------------------
+void VgaText_Initialise(void)
+{
+	memset(g_aTextChar, ' ', sizeof(g_aTextChar));
+	memset(g_aTextColour, RGB111_BLACK, sizeof(g_aTextColour));
+	memset(s_aDrawnChar, ' ', sizeof(s_aDrawnChar));
+	memset(s_aDrawnColour, RGB111_BLACK, sizeof(s_aDrawnColour));
+	g_uTextDirtyRows = 0;
+}
+
+//------------------------------------------------------------------------------------------------
+//---- VgaText_DrawString                                                                     ----
+//------------------------------------------------------------------------------------------------
+u32 VgaText_DrawString(const u32 uCharX, const u32 uCharY, const char* pszString, const u8 uColour)
+{
+	u32 uX = uCharX;
+
+	while (*pszString && (uX < VGA_TEXT_COLUMNS))
+		VgaText_PutChar(uX++, uCharY, ascii_to_petscii((u8)*pszString++), uColour);
+
+	return uX;
+}
+
+//------------------------------------------------------------------------------------------------
+//---- VgaText_Flush                                                                          ----
+//------------------------------------------------------------------------------------------------
+u32 VgaText_Flush(void)
+{
+	u64 uDirtyRows = g_uTextDirtyRows;
+	u32 uDrawn = 0;
+
+	g_uTextDirtyRows = 0;
+
+	while (uDirtyRows)
+	{
+		const u32 uRow = __builtin_ctzll(uDirtyRows);
+		uDirtyRows &= uDirtyRows - 1;
+
+		for (u32 uColumn=0; uColumn<VGA_TEXT_COLUMNS; ++uColumn)
+		{
+			const u8 uChar = g_aTextChar[uRow][uColumn];
+			const u8 uColour = g_aTextColour[uRow][uColumn];
+
+			if ((uChar == s_aDrawnChar[uRow][uColumn]) && (uColour == s_aDrawnColour[uRow][uColumn]))
+				continue;
+
+			vga_DrawPetsciiChar(uColumn << 3, uRow << 3, uChar, uColour);
+			s_aDrawnChar[uRow][uColumn] = uChar;
+			s_aDrawnColour[uRow][uColumn] = uColour;
+			++uDrawn;
+		}
+	}
+
+	return uDrawn;
+}
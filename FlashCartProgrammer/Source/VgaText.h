@@ -0,0 +1,45 @@
+//------------------------------------------------------------------------------------------------
+//---- VgaText.h (C) 2026 Dave Gaunt                                                          ----
+//------------------------------------------------------------------------------------------------
+//---- Character Cell Layer Over vga111. Writes Only Touch The Cell Buffer, VgaText_Flush     ----
+//---- Rasterises The Cells That Changed Since The Last Flush.                                ----
+//------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <assert.h>
+#include "types.h"
+#include "vga111.h"
+
+#define VGA_TEXT_COLUMNS	(VGA_RESOLUTION_X >> 3)
+#define VGA_TEXT_ROWS		(VGA_RESOLUTION_Y >> 3)
+
+extern u8 g_aTextChar[VGA_TEXT_ROWS][VGA_TEXT_COLUMNS];		// PETSCII
+extern u8 g_aTextColour[VGA_TEXT_ROWS][VGA_TEXT_COLUMNS];	// RGB111
+extern u64 g_uTextDirtyRows;
+
+static_assert(VGA_TEXT_ROWS <= 64, "One dirty bit per row");
+
+//------------------------------------------------------------------------------------------------
+//---- VgaText_PutChar                                                                        ----
+//------------------------------------------------------------------------------------------------
+static inline void VgaText_PutChar(const u32 uCharX, const u32 uCharY, const u8 uChar, const u8 uColour)
+{
+	g_aTextChar[uCharY][uCharX] = uChar;
+	g_aTextColour[uCharY][uCharX] = uColour;
+	g_uTextDirtyRows |= (1ull << uCharY);
+}
+
+u8 ascii_to_petscii(const u8 c);
+
+// 6 Digit Address, 16 Hex Bytes And Their Characters, 73 Cells Wide.
+void FormatHexDumpLine(u32 uCharX, u32 uCharY, const u32 uAddress, const u8* pLineBuffer, const u8 uColour, const bool bASCII);
+
+// Every Cell Becomes A Black Space, Matching A Freshly Cleared Screen.
+void VgaText_Initialise(void);
+
+// ASCII, Clipped At The Right Hand Edge. Returns The Column After The Last Character.
+u32 VgaText_DrawString(const u32 uCharX, const u32 uCharY, const char* pszString, const u8 uColour);
+
+// Draws Cells Whose Character Or Colour Differ From What Is On Screen, Returns How Many.
+u32 VgaText_Flush(void);
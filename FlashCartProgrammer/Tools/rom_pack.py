@@ -0,0 +1,189 @@
+#!/usr/bin/env python3
+#------------------------------------------------------------------------------------------------
+#---- rom_pack.py - Compress a ROM image for SDCard_WriteToFlash                             ----
+#------------------------------------------------------------------------------------------------
+#---- Layout (little endian):                                                                ----
+#----                                                                                        ----
+#----   u32 magic "ROMZ"   u8 version   u8 window bits   u8 lookahead bits   u8 reserved     ----
+#----   u32 unpacked length   u32 crc32 (zlib) of the unpacked bytes                         ----
+#----   heatshrink stream                                                                    ----
+#----                                                                                        ----
+#---- The stream is standard heatshrink, so `heatshrink -d -w W -l L` unpacks it once the    ----
+#---- 16 byte header is stripped. The programmer only keeps the window in RAM, 2^W bytes,    ----
+#---- and recognises packed files by the magic so they can have any name.                    ----
+#----                                                                                        ----
+#---- Must match RomUnpack.h.                                                                ----
+#----                                                                                        ----
+#----   rom_pack.py Kickstart_2_04.rom Kickstart_2_04.rz                                     ----
+#------------------------------------------------------------------------------------------------
+
+import argparse
+import struct
+import sys
+import zlib
+
+MAGIC = 0x5A4D4F52          # "ROMZ"
+VERSION = 1
+HEADER = struct.Struct("<IBBBBII")
+MAX_WINDOW_BITS = 12        # ROM_UNPACK_MAX_WINDOW_BITS
+MAX_CHAIN = 64              # Candidates tried per position, more is slower for little gain
+
+
+#------------------------------------------------------------------------------------------------
+#---- BitWriter                                                                              ----
+#------------------------------------------------------------------------------------------------
+class BitWriter:
+	def __init__(self):
+		self.data = bytearray()
+		self.bits = 0
+		self.count = 0
+
+	def put(self, value, count):
+		self.bits = (self.bits << count) | value
+		self.count += count
+		while self.count >= 8:
+			self.count -= 8
+			self.data.append((self.bits >> self.count) & 0xFF)
+		self.bits &= (1 << self.count) - 1
+
+	def flush(self):
+		if self.count:
+			self.data.append((self.bits << (8 - self.count)) & 0xFF)
+			self.bits = self.count = 0
+		return bytes(self.data)
+
+
+#------------------------------------------------------------------------------------------------
+#---- compress - Greedy heatshrink encoder with hash chains                                  ----
+#------------------------------------------------------------------------------------------------
+def compress(data, window_bits, lookahead_bits):
+	window = 1 << window_bits
+	max_match = 1 << lookahead_bits
+	backref_bits = 1 + window_bits + lookahead_bits
+	chains = {}
+	out = BitWriter()
+	pos = 0
+
+	def insert(at):
+		if at + 3 <= len(data):
+			chains.setdefault(data[at:at + 3], []).append(at)
+
+	while pos < len(data):
+		best_length, best_offset = 0, 0
+		limit = min(max_match, len(data) - pos)
+
+		# Matches may overlap the current position, the decoder copies a byte at a time.
+		for candidate in reversed(chains.get(data[pos:pos + 3], [])[-MAX_CHAIN:]):
+			offset = pos - candidate
+			if offset > window:
+				break
+			length = 3
+			while length < limit and data[candidate + length] == data[pos + length]:
+				length += 1
+			if length > best_length:
+				best_length, best_offset = length, offset
+				if length == limit:
+					break
+
+		# Only worth a back reference when it is shorter than the literals it replaces.
+		if best_length * 9 > backref_bits:
+			out.put(0, 1)
+			out.put(best_offset - 1, window_bits)
+			out.put(best_length - 1, lookahead_bits)
+		else:
+			best_length = 1
+			out.put(0x100 | data[pos], 9)
+
+		for at in range(pos, pos + best_length):
+			insert(at)
+		pos += best_length
+
+	return out.flush()
+
+
+#------------------------------------------------------------------------------------------------
+#---- decompress - Mirrors RomUnpack_Read                                                    ----
+#------------------------------------------------------------------------------------------------
+def decompress(stream, length, window_bits, lookahead_bits):
+	out = bytearray()
+	bit_pos = 0
+
+	def get(count):
+		nonlocal bit_pos
+		value = 0
+		for _ in range(count):
+			if bit_pos >> 3 >= len(stream):
+				raise ValueError("packed data ends early")
+			value = (value << 1) | ((stream[bit_pos >> 3] >> (7 - (bit_pos & 7))) & 1)
+			bit_pos += 1
+		return value
+
+	while len(out) < length:
+		if get(1):
+			out.append(get(8))
+		else:
+			offset = get(window_bits) + 1
+			count = get(lookahead_bits) + 1
+			for _ in range(count):
+				# References before the start read the zeroed window.
+				out.append(out[-offset] if offset <= len(out) else 0)
+
+	return bytes(out[:length])
+
+
+#------------------------------------------------------------------------------------------------
+#---- pack                                                                                   ----
+#------------------------------------------------------------------------------------------------
+def pack(data, window_bits=MAX_WINDOW_BITS, lookahead_bits=8):
+	if not 4 <= window_bits <= MAX_WINDOW_BITS:
+		raise ValueError("window bits must be 4..%d" % MAX_WINDOW_BITS)
+	if not 3 <= lookahead_bits < window_bits:
+		raise ValueError("lookahead bits must be 3..%d" % (window_bits - 1))
+
+	header = HEADER.pack(MAGIC, VERSION, window_bits, lookahead_bits, 0, len(data), zlib.crc32(data))
+	return header + compress(data, window_bits, lookahead_bits)
+
+
+#------------------------------------------------------------------------------------------------
+#---- unpack                                                                                 ----
+#------------------------------------------------------------------------------------------------
+def unpack(packed):
+	magic, version, window_bits, lookahead_bits, _, length, crc32 = HEADER.unpack_from(packed)
+	if magic != MAGIC or version != VERSION:
+		raise ValueError("not a packed ROM image")
+
+	data = decompress(packed[HEADER.size:], length, window_bits, lookahead_bits)
+	if zlib.crc32(data) != crc32:
+		raise ValueError("CRC32 mismatch")
+	return data
+
+
+#------------------------------------------------------------------------------------------------
+#---- main                                                                                   ----
+#------------------------------------------------------------------------------------------------
+def main():
+	parser = argparse.ArgumentParser(description="Compress a ROM image for the flash cart programmer.")
+	parser.add_argument("input", help="raw ROM image")
+	parser.add_argument("output", help="packed image to write to the SD card")
+	parser.add_argument("-w", "--window", type=int, default=MAX_WINDOW_BITS, help="window bits, the programmer needs 2^W bytes of RAM")
+	parser.add_argument("-l", "--lookahead", type=int, default=8, help="lookahead bits, the longest match is 2^L bytes")
+	args = parser.parse_args()
+
+	with open(args.input, "rb") as f:
+		data = f.read()
+
+	try:
+		packed = pack(data, args.window, args.lookahead)
+		if unpack(packed) != data:
+			raise ValueError("does not round trip through the unpacker")
+	except ValueError as e:
+		sys.exit("rom_pack.py: %s: %s" % (args.input, e))
+
+	with open(args.output, "wb") as f:
+		f.write(packed)
+
+	print("%s: %d -> %d bytes (%.1f%%)" % (args.input, len(data), len(packed), 100.0 * len(packed) / max(len(data), 1)))
+
+
+if __name__ == "__main__":
+	main()
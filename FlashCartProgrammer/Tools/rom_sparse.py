@@ -0,0 +1,155 @@
+#!/usr/bin/env python3
+#------------------------------------------------------------------------------------------------
+#---- rom_sparse.py - Turn a ROM image into a sparse one with its 0xFF padding left out      ----
+#------------------------------------------------------------------------------------------------
+#---- Layout (little endian):                                                                ----
+#----                                                                                        ----
+#----   u32 magic "ROMS"   u16 version   u16 count   u32 image length   u32 reserved         ----
+#----   count x { u32 offset, u32 length, u32 file offset }                                  ----
+#----   data extents, each padded to start on a 512 byte boundary                            ----
+#----                                                                                        ----
+#---- The extents cover the image in order. A file offset of 0xFFFFFFFF marks a hole, which  ----
+#---- is all 0xFF and has no bytes in the file. Holes are whole --granule blocks, 1K by      ----
+#---- default to match the programmer's verify blocks and keep 16 bit parts word aligned.    ----
+#----                                                                                        ----
+#---- Must match RomSparse.h.                                                                ----
+#----                                                                                        ----
+#----   rom_sparse.py Kickstart_2_04.rom Kickstart_2_04.rsp                                  ----
+#----   rom_sparse.py --expand Kickstart_2_04.rsp Kickstart_2_04.rom                         ----
+#------------------------------------------------------------------------------------------------
+
+import argparse
+import struct
+import sys
+
+MAGIC = 0x534D4F52          # "ROMS"
+VERSION = 1
+HEADER = struct.Struct("<IHHII")
+EXTENT = struct.Struct("<III")
+MAX_EXTENTS = 256           # ROM_SPARSE_MAX_EXTENTS
+ALIGN = 512                 # ROM_SPARSE_ALIGN
+HOLE = 0xFFFFFFFF           # ROM_SPARSE_HOLE
+
+
+#------------------------------------------------------------------------------------------------
+#---- find_extents - [(offset, length, is_hole)], holes at least min_hole granules long      ----
+#------------------------------------------------------------------------------------------------
+def find_extents(data, granule, min_hole):
+	blank = b"\xff" * granule
+	extents = []
+
+	for offset in range(0, len(data), granule):
+		block = data[offset:offset + granule]
+		is_hole = block == blank[:len(block)]
+		if extents and extents[-1][2] == is_hole:
+			extents[-1][1] += len(block)
+		else:
+			extents.append([offset, len(block), is_hole])
+
+	# Holes too short to be worth an extent go back in with their neighbours.
+	merged = []
+	for offset, length, is_hole in extents:
+		if is_hole and length < min_hole * granule:
+			is_hole = False
+		if merged and merged[-1][2] == is_hole:
+			merged[-1][1] += length
+		else:
+			merged.append([offset, length, is_hole])
+
+	return merged
+
+
+#------------------------------------------------------------------------------------------------
+#---- build_sparse                                                                           ----
+#------------------------------------------------------------------------------------------------
+def build_sparse(data, granule):
+	if granule <= 0 or granule % 2:
+		raise ValueError("granule must be a positive even number of bytes")
+	if not data:
+		raise ValueError("image is empty")
+
+	# Fewer, longer holes until the table fits.
+	min_hole = 1
+	extents = find_extents(data, granule, min_hole)
+	while len(extents) > MAX_EXTENTS:
+		min_hole *= 2
+		extents = find_extents(data, granule, min_hole)
+
+	file_offset = HEADER.size + EXTENT.size * len(extents)
+	table = bytearray()
+	payloads = bytearray()
+
+	for offset, length, is_hole in extents:
+		if is_hole:
+			table += EXTENT.pack(offset, length, HOLE)
+			continue
+
+		padding = (-file_offset) % ALIGN
+		payloads += b"\xff" * padding
+		file_offset += padding
+
+		table += EXTENT.pack(offset, length, file_offset)
+		payloads += data[offset:offset + length]
+		file_offset += length
+
+	header = HEADER.pack(MAGIC, VERSION, len(extents), len(data), 0)
+	return header + table + payloads, extents
+
+
+#------------------------------------------------------------------------------------------------
+#---- expand                                                                                 ----
+#------------------------------------------------------------------------------------------------
+def expand(sparse):
+	magic, version, count, length, _ = HEADER.unpack_from(sparse)
+	if magic != MAGIC or version != VERSION:
+		raise ValueError("not a sparse ROM image")
+
+	data = bytearray()
+	for i in range(count):
+		offset, extent_length, file_offset = EXTENT.unpack_from(sparse, HEADER.size + EXTENT.size * i)
+		if offset != len(data):
+			raise ValueError("extent %d is out of order" % i)
+		if file_offset == HOLE:
+			data += b"\xff" * extent_length
+		else:
+			data += sparse[file_offset:file_offset + extent_length]
+
+	if len(data) != length:
+		raise ValueError("extents cover %d bytes, the header says %d" % (len(data), length))
+	return bytes(data)
+
+
+#------------------------------------------------------------------------------------------------
+#---- main                                                                                   ----
+#------------------------------------------------------------------------------------------------
+def main():
+	parser = argparse.ArgumentParser(description="Build a sparse ROM image for the flash cart programmer.")
+	parser.add_argument("input", help="raw ROM image, or sparse image with --expand")
+	parser.add_argument("output", help="file to write")
+	parser.add_argument("--granule", type=int, default=1024, help="hole granularity in bytes")
+	parser.add_argument("--expand", action="store_true", help="turn a sparse image back into a raw one")
+	args = parser.parse_args()
+
+	with open(args.input, "rb") as f:
+		data = f.read()
+
+	try:
+		if args.expand:
+			output = expand(data)
+		else:
+			output, extents = build_sparse(data, args.granule)
+			if expand(output) != data:
+				raise ValueError("does not round trip")
+	except ValueError as e:
+		sys.exit("rom_sparse.py: %s: %s" % (args.input, e))
+
+	with open(args.output, "wb") as f:
+		f.write(output)
+
+	if not args.expand:
+		holes = sum(length for _, length, is_hole in extents if is_hole)
+		print("%s: %d -> %d bytes, %d extents, %d bytes of holes" % (args.input, len(data), len(output), len(extents), holes))
+
+
+if __name__ == "__main__":
+	main()
@@ -0,0 +1,194 @@
+#!/usr/bin/env python3
+#------------------------------------------------------------------------------------------------
+#---- trace_decode.py - Turn EventTrace.bin from the programmer into a timeline              ----
+#------------------------------------------------------------------------------------------------
+#---- Prints every event with its time since the start of the trace and, for END events,    ----
+#---- how long the matching BEGIN took, followed by a per event summary. --chrome writes a  ----
+#---- Trace Event Format file for chrome://tracing or ui.perfetto.dev.                      ----
+#------------------------------------------------------------------------------------------------
+
+import argparse
+import json
+import struct
+import sys
+
+HEADER_SIZE = 512
+MAGIC = 0x52545645          # "EVTR"
+
+# Keep in step with EVENT_ID in FatFs_SPI/include/event_trace.h
+EVENT_NAMES = [
+	"MARK",
+	"FLASH_COMMAND",
+	"FLASH_PROGRAM_BEGIN",
+	"FLASH_PROGRAM_END",
+	"FLASH_READ_BEGIN",
+	"FLASH_READ_END",
+	"FLASH_ERASE_BEGIN",
+	"FLASH_ERASE_END",
+	"FLASH_FAIL",
+	"SPI_TRANSFER_BEGIN",
+	"SPI_TRANSFER_END",
+	"SD_CMD_BEGIN",
+	"SD_CMD_END",
+	"DISK_READ_BEGIN",
+	"DISK_READ_END",
+	"FLASH_BLOCK_BEGIN",
+	"FLASH_BLOCK_END",
+]
+
+# Arguments that are signed values squeezed into 24 bits.
+SIGNED_ARGS = {"SD_CMD_END"}
+
+
+#------------------------------------------------------------------------------------------------
+#---- load_trace                                                                             ----
+#------------------------------------------------------------------------------------------------
+def load_trace(data):
+	magic, version, cores, entries, clock_hz = struct.unpack_from("<IHHII", data, 0)
+	if magic != MAGIC:
+		raise ValueError("not an event trace (bad magic 0x%08X)" % magic)
+	if version != 1:
+		raise ValueError("unsupported event trace version %d" % version)
+
+	heads = struct.unpack_from("<%dI" % cores, data, 16)
+	ring_bytes = entries * 8
+	rings = []
+
+	for core in range(cores):
+		base = HEADER_SIZE + core * ring_bytes
+		head = heads[core]
+
+		# Once the ring has wrapped the oldest surviving entry sits at the head.
+		if head > entries:
+			order = [(head + i) % entries for i in range(entries)]
+		else:
+			order = range(head)
+
+		events = []
+		last = None
+		elapsed = 0
+		for index in order:
+			cycles, event = struct.unpack_from("<II", data, base + index * 8)
+
+			# The 32 bit cycle counter wraps every few tens of seconds, unwrap it.
+			if last is not None:
+				elapsed += (cycles - last) & 0xFFFFFFFF
+			last = cycles
+
+			event_id = event >> 24
+			arg = event & 0xFFFFFF
+			name = EVENT_NAMES[event_id] if event_id < len(EVENT_NAMES) else "EVENT_%d" % event_id
+			if name in SIGNED_ARGS and arg & 0x800000:
+				arg -= 0x1000000
+
+			events.append((elapsed, name, arg))
+
+		rings.append({"core": core, "recorded": head, "dropped": max(0, head - entries), "events": events})
+
+	return clock_hz, rings
+
+
+#------------------------------------------------------------------------------------------------
+#---- pair_events - Attach each END to the innermost open BEGIN of the same kind             ----
+#------------------------------------------------------------------------------------------------
+def pair_events(events):
+	open_events = {}
+	spans = []
+
+	for position, (cycles, name, arg) in enumerate(events):
+		if name.endswith("_BEGIN"):
+			open_events.setdefault(name[:-6], []).append((position, cycles, arg))
+		elif name.endswith("_END"):
+			stack = open_events.get(name[:-4])
+			if stack:
+				begin_position, begin_cycles, begin_arg = stack.pop()
+				spans.append((name[:-4], begin_position, position, begin_cycles, cycles, begin_arg, arg))
+
+	return spans
+
+
+#------------------------------------------------------------------------------------------------
+#---- print_timeline                                                                         ----
+#------------------------------------------------------------------------------------------------
+def print_timeline(clock_hz, rings, out):
+	to_us = 1e6 / clock_hz
+
+	for ring in rings:
+		events = ring["events"]
+		out.write("Core %d: %d events recorded, %d overwritten\n" % (ring["core"], ring["recorded"], ring["dropped"]))
+		if not events:
+			continue
+
+		durations = {}
+		summary = {}
+		for kind, _, end, begin_cycles, end_cycles, _, _ in pair_events(events):
+			cycles = end_cycles - begin_cycles
+			durations[end] = cycles
+			count, total, worst = summary.get(kind, (0, 0, 0))
+			summary[kind] = (count + 1, total + cycles, max(worst, cycles))
+
+		for position, (cycles, name, arg) in enumerate(events):
+			line = "%12.3f us  %-20s 0x%06X" % (cycles * to_us, name, arg & 0xFFFFFF) if arg >= 0 else \
+				   "%12.3f us  %-20s %9d" % (cycles * to_us, name, arg)
+			if position in durations:
+				line += "  (%.3f us)" % (durations[position] * to_us)
+			out.write(line + "\n")
+
+		out.write("\n%-16s %8s %14s %12s %12s\n" % ("Operation", "Count", "Total us", "Mean us", "Max us"))
+		for kind in sorted(summary, key=lambda k: -summary[k][1]):
+			count, total, worst = summary[kind]
+			out.write("%-16s %8d %14.1f %12.3f %12.3f\n" % (kind, count, total * to_us, total * to_us / count, worst * to_us))
+		out.write("\n")
+
+
+#------------------------------------------------------------------------------------------------
+#---- write_chrome_trace                                                                     ----
+#------------------------------------------------------------------------------------------------
+def write_chrome_trace(clock_hz, rings, path):
+	to_us = 1e6 / clock_hz
+	trace = []
+
+	for ring in rings:
+		events = ring["events"]
+		paired = set()
+
+		for kind, begin, end, begin_cycles, end_cycles, begin_arg, end_arg in pair_events(events):
+			paired.update((begin, end))
+			trace.append({"name": kind, "ph": "X", "pid": 0, "tid": ring["core"],
+						  "ts": begin_cycles * to_us, "dur": (end_cycles - begin_cycles) * to_us,
+						  "args": {"begin": begin_arg, "end": end_arg}})
+
+		for position, (cycles, name, arg) in enumerate(events):
+			if position not in paired:
+				trace.append({"name": name, "ph": "i", "s": "t", "pid": 0, "tid": ring["core"],
+							  "ts": cycles * to_us, "args": {"arg": arg}})
+
+	with open(path, "w") as f:
+		json.dump({"traceEvents": trace, "displayTimeUnit": "ns"}, f)
+
+
+#------------------------------------------------------------------------------------------------
+#---- main                                                                                   ----
+#------------------------------------------------------------------------------------------------
+def main():
+	parser = argparse.ArgumentParser(description="Decode an EventTrace.bin dumped by the flash cart programmer.")
+	parser.add_argument("trace", help="EventTrace.bin copied from the SD card")
+	parser.add_argument("--chrome", metavar="JSON", help="also write a chrome://tracing / Perfetto file")
+	args = parser.parse_args()
+
+	with open(args.trace, "rb") as f:
+		data = f.read()
+
+	try:
+		clock_hz, rings = load_trace(data)
+	except (ValueError, struct.error) as e:
+		sys.exit("%s: %s" % (args.trace, e))
+
+	print_timeline(clock_hz, rings, sys.stdout)
+
+	if args.chrome:
+		write_chrome_trace(clock_hz, rings, args.chrome)
+
+
+if __name__ == "__main__":
+	main()
@@ -0,0 +1,135 @@
+//------------------------------------------------------------------------------------------------
+//---- BootTimeline.c (C) 2023 Dave Gaunt                                                     ----
+//------------------------------------------------------------------------------------------------
+//---- The DWT cycle counter runs at clk_sys, which wraps after ~28s at 150MHz - far longer   ----
+//---- than boot takes. CDONE is timed by a GPIO edge IRQ rather than polled so the mark is   ----
+//---- right even when it rises part way through the wake up clocks.                          ----
+//------------------------------------------------------------------------------------------------
+
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "hardware/clocks.h"
+#include "hardware/structs/m33.h"
+
+#include "vga111.h"
+#include "BootTimeline.h"
+
+static u32 s_aMarkCycles[BOOT_MARK_COUNT];
+static u32 s_uMarkValid = 0;					// Bit Per Mark
+
+static const char* s_apszMarkName[BOOT_MARK_COUNT] =
+{
+	"Start",
+	"Config Ready",
+	"Reset Released",
+	"Cleared",
+	"VGA Ready",
+	"Clock Ready",
+	"Upload Done",
+	"Wake Done",
+	"CDONE"
+};
+
+//------------------------------------------------------------------------------------------------
+//---- BootTimeline_CDoneIrq                                                                  ----
+//------------------------------------------------------------------------------------------------
+static void BootTimeline_CDoneIrq(uint uGpio, uint32_t uEvents)
+{
+	// First Rise Only, A Reload Later On Would Otherwise Move It
+	if (!(s_uMarkValid & (1 << BOOT_MARK_CDONE)))
+		BootTimeline_Mark(BOOT_MARK_CDONE);
+
+	gpio_set_irq_enabled(uGpio, GPIO_IRQ_EDGE_RISE, false);
+}
+
+//------------------------------------------------------------------------------------------------
+//---- BootTimeline_Initialise                                                                ----
+//------------------------------------------------------------------------------------------------
+void BootTimeline_Initialise(const u32 uPinCDone)
+{
+	m33_hw->demcr |= M33_DEMCR_TRCENA_BITS;
+	m33_hw->dwt_cyccnt = 0;
+	m33_hw->dwt_ctrl |= M33_DWT_CTRL_CYCCNTENA_BITS;
+
+	s_uMarkValid = 0;
+	BootTimeline_Mark(BOOT_MARK_START);
+
+	gpio_set_irq_enabled_with_callback(uPinCDone, GPIO_IRQ_EDGE_RISE, true, BootTimeline_CDoneIrq);
+}
+
+//------------------------------------------------------------------------------------------------
+//---- BootTimeline_Mark                                                                      ----
+//------------------------------------------------------------------------------------------------
+void BootTimeline_Mark(const enum boot_mark eMark)
+{
+	s_aMarkCycles[eMark] = m33_hw->dwt_cyccnt;
+	s_uMarkValid |= (1 << eMark);
+}
+
+//------------------------------------------------------------------------------------------------
+//---- BootTimeline_GetUs                                                                     ----
+//------------------------------------------------------------------------------------------------
+int BootTimeline_GetUs(const enum boot_mark eMark)
+{
+	if (!(s_uMarkValid & (1 << eMark)))
+		return -1;
+
+	const u32 uCyclesPerUs = clock_get_hz(clk_sys) / 1000000;
+	return (int)((s_aMarkCycles[eMark] - s_aMarkCycles[BOOT_MARK_START]) / uCyclesPerUs);
+}
+
+//------------------------------------------------------------------------------------------------
+//---- BootTimeline_GetName                                                                   ----
+//------------------------------------------------------------------------------------------------
+const char* BootTimeline_GetName(const enum boot_mark eMark)
+{
+	return s_apszMarkName[eMark];
+}
+
+//------------------------------------------------------------------------------------------------
+//---- BootTimeline_Draw                                                                      ----
+//------------------------------------------------------------------------------------------------
+void BootTimeline_Draw(const u32 uX, const u32 uRow)
+{
+	char szTempString[64];
+
+	for (u32 i=BOOT_MARK_START+1; i<BOOT_MARK_COUNT; ++i)
+	{
+		const int iUs = BootTimeline_GetUs((enum boot_mark)i);
+
+		if (iUs < 0)
+		{
+			sprintf(szTempString, "%-14s      ---", s_apszMarkName[i]);
+			vga_DrawString(uX, uRow + i - 1, szTempString, RGB111_RED);
+		}
+		else
+		{
+			sprintf(szTempString, "%-14s %8d us", s_apszMarkName[i], iUs);
+			vga_DrawString(uX, uRow + i - 1, szTempString, RGB111_GREEN);
+		}
+	}
+}
+
+//------------------------------------------------------------------------------------------------
+//---- BootTimeline_Print                                                                     ----
+//------------------------------------------------------------------------------------------------
+void BootTimeline_Print(void)
+{
+	int iPrevious = 0;
+
+	for (u32 i=BOOT_MARK_START+1; i<BOOT_MARK_COUNT; ++i)
+	{
+		const int iUs = BootTimeline_GetUs((enum boot_mark)i);
+
+		if (iUs < 0)
+		{
+			printf("BOOT %-14s ---\n", s_apszMarkName[i]);
+			continue;
+		}
+
+		printf("BOOT %-14s %8d us (%+d)\n", s_apszMarkName[i], iUs, iUs - iPrevious);
+		iPrevious = iUs;
+	}
+
+	stdio_flush();
+}
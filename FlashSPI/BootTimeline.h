@@ -0,0 +1,41 @@
+//------------------------------------------------------------------------------------------------
+//---- BootTimeline.h (C) 2023 Dave Gaunt                                                     ----
+//------------------------------------------------------------------------------------------------
+//---- Cycle Counter Timestamps For Each Stage Of Bringing The FPGA Up                        ----
+//------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "types.h"
+
+// In The Order They Normally Happen, VGA Set Up Overlaps The Upload.
+enum boot_mark
+{
+	BOOT_MARK_START = 0,					// main() Entered
+	BOOT_MARK_CONFIG_READY,					// SPI, Pins And DMA Set Up
+	BOOT_MARK_RESET_RELEASED,				// CRESET High With CS Low
+	BOOT_MARK_CLEARED,						// 1200us Clearing Time Over, Upload Starts
+	BOOT_MARK_VGA_READY,
+	BOOT_MARK_CLOCK_READY,					// 25MHz Clock Out
+	BOOT_MARK_UPLOAD_DONE,					// Last Bit Shifted Out
+	BOOT_MARK_WAKE_DONE,					// Dummy Clocks Sent With CS High
+	BOOT_MARK_CDONE,						// Rising Edge, Caught By GPIO IRQ
+	BOOT_MARK_COUNT
+};
+
+// Starts The Cycle Counter, Records BOOT_MARK_START And Arms The CDONE Edge IRQ.
+void BootTimeline_Initialise(const u32 uPinCDone);
+
+// Records The Latest Time, So A Retried Upload Shows The Attempt That Worked.
+void BootTimeline_Mark(const enum boot_mark eMark);
+
+// Microseconds From BOOT_MARK_START, Or -1 If The Mark Never Happened.
+int BootTimeline_GetUs(const enum boot_mark eMark);
+
+const char* BootTimeline_GetName(const enum boot_mark eMark);
+
+// One Line Per Mark Starting At Text Row uRow.
+void BootTimeline_Draw(const u32 uX, const u32 uRow);
+
+// One Line Per Mark On stdio.
+void BootTimeline_Print(void);
@@ -7,13 +7,30 @@
 #include <stdio.h>
 #include "types.h"
 #include "pico/stdlib.h"
+#include "pico/stdio_usb.h"
 #include "hardware/clocks.h"
 
 #include "vga111.h"
 #include "SpiNorFlash.h"
-#include "iCE40_BitStream.h"
+#include "BootTimeline.h"
+#include "SpiNorUpdate.h"
+#include "iCE40Archive.h"
+#include "iCE40Config.h"
+#include "iCE40Reload.h"
+#include "iCE40_Archive.h"			// Generated By Tools/bitstream_archive.py, Linked By iCE40_Archive.S
+
+#ifndef FLASHSPI_PROGRAM_SPI_NOR
+#define FLASHSPI_PROGRAM_SPI_NOR	(0)		/* 1 - Update The FPGA's SPI Flash Instead Of Uploading Directly */
+#endif
+
+#ifndef FLASHSPI_BOOT_TIMELINE_STDIO
+#define FLASHSPI_BOOT_TIMELINE_STDIO	(0)	/* 1 - Print The Boot Timeline Once USB Is Connected */
+#endif
 
 #define SPI_BAUD_RATE	(20 * 1000 * 1000)	/* 20Mhz */
+#define ICE40_MAX_BAUD	(25 * 1000 * 1000)	/* iCE40 Slave SPI Configuration Maximum (TN1248), clk_peri / 6 */
+#define ICE40_MIN_BAUD	(10 * 1000 * 1000)	/* 10Mhz */
+#define NUM_BITSTREAM_STRAPS	(2)
 #define VGA_PAL_CLOCK	(25000000)
 
 enum board_pins{
@@ -25,6 +42,7 @@ enum board_pins{
 	PIN_SPI_MISO,
 	PIN_25MHZ_CLOCK,
 	PIN_FPGA_CDONE,
+	PIN_BITSTREAM_STRAP = 26,		// Two Straps, 26 And 27
 	PIN_FPGA_RESET = 41
 };
 
@@ -33,7 +51,7 @@ static_assert(21 == PIN_25MHZ_CLOCK, "Pico only exposes PIN_21 for external cloc
 //------------------------------------------------------------------------------------------------
 //---- Program SPI Nor Flash                                                                  ----
 //------------------------------------------------------------------------------------------------
-/*
+#if FLASHSPI_PROGRAM_SPI_NOR
 int main()
 {
 	stdio_init_all();
@@ -48,37 +66,48 @@ int main()
 	vga_FilledRect(0, 0, VGA_RESOLUTION_X, VGA_RESOLUTION_Y, RGB111_GREEN);
 	vga_FilledRect(1, 1, VGA_RESOLUTION_X-2, VGA_RESOLUTION_Y-2, RGB111_BLACK);
 
-	if(SpiNorFlash_Initialise(spi0, SPI_BAUD_RATE, PIN_SPI_CLOCK, PIN_SPI_MOSI, PIN_SPI_MISO, PIN_SPI_CS))
+	const bool bArchiveValid = iCE40Archive_Verify(iCE40_Archive, iCE40_Archive_end - iCE40_Archive, ICE40_ARCHIVE_SIZE, ICE40_ARCHIVE_CRC32);
+	const u32 uBitStream = iCE40Archive_SelectBoot(iCE40_Archive, PIN_BITSTREAM_STRAP, NUM_BITSTREAM_STRAPS);
+	const iCE40ArchiveEntry* pEntry = bArchiveValid ? iCE40Archive_GetEntry(iCE40_Archive, uBitStream) : NULL;
+	char szTempString[128];
+
+	vga_DrawString(4, 12, "Build " ICE40_ARCHIVE_BUILD_HASH, bArchiveValid ? RGB111_GREEN : RGB111_RED);
+
+	if (NULL == pEntry)
 	{
-		vga_FilledRect(0, 0, VGA_RESOLUTION_X, VGA_RESOLUTION_Y, RGB111_GREEN);
+		sprintf(szTempString, "Bitstream %d Missing Or Corrupt!!!", uBitStream);
+		vga_DrawString(4, 4, szTempString, RGB111_RED);
+	}
+	else if (SpiNorFlash_Initialise(spi0, SPI_BAUD_RATE, PIN_SPI_CLOCK, PIN_SPI_MOSI, PIN_SPI_MISO, PIN_SPI_CS) && SpiNorUpdate_Initialise(spi0, PIN_SPI_CS))
+	{
+		// Only Sectors That Differ Are Erased, Only Pages That Aren't 0xFF Are Programmed
+		SpiNorUpdateStats stats;
+		const bool bValid = SpiNorUpdate_Image(0, iCE40_Archive + pEntry->m_uOffset, pEntry->m_uSize, pEntry->m_uLength, pEntry->m_uFlags & ICE40_ARCHIVE_FLAG_PACKED, &stats);
 
-		if (SpiNorFlash_Verify(0, iCE40_BitStream_size, iCE40_BitStream))
+		if (!bValid)
 		{
-			// Flash Data Verified And Correct - Nothing To Do !!!
+			// Rewrite Failed - Flash Data Is Corrupt!!!
+			vga_FilledRect(0, 0, VGA_RESOLUTION_X, VGA_RESOLUTION_Y, RGB111_RED);
 			vga_FilledRect(1, 1, VGA_RESOLUTION_X-2, VGA_RESOLUTION_Y-2, RGB111_BLACK);
+			vga_DrawString(4, 4, "FPGA Binary Corrupt!!!", RGB111_RED);
+		}
+		else if (0 == stats.m_uSectorsChanged)
+		{
+			// Flash Data Verified And Correct - Nothing To Do !!!
 			vga_DrawString(4, 4, "FPGA Binary Valid.", RGB111_GREEN);
 		}
 		else
 		{
-			// Erase Flash Memory And Attempt To Rewrite Data.
-			SpiNorFlash_Erase64kBlock(0);
-			SpiNorFlash_Erase64kBlock(1);
-			SpiNorFlash_Erase64kBlock(2);
-
-			if (SpiNorFlash_Write(0, iCE40_BitStream_size, iCE40_BitStream, true))
-			{
-				// Rewrite Success - Flash Data Is Valid And Up To Date.
-				vga_FilledRect(1, 1, VGA_RESOLUTION_X-2, VGA_RESOLUTION_Y-2, RGB111_BLACK);
-				vga_DrawString(4, 4, "FPGA Binary Updated And Valid.", RGB111_GREEN);
-			}
-			else
-			{
-				// Rewrite Failed - Flash Data Is Corrupt!!!
-				vga_FilledRect(0, 0, VGA_RESOLUTION_X, VGA_RESOLUTION_Y, RGB111_RED);
-				vga_FilledRect(1, 1, VGA_RESOLUTION_X-2, VGA_RESOLUTION_Y-2, RGB111_BLACK);
-				vga_DrawString(4, 4, "FPGA Binary Corrupt!!!", RGB111_RED);
-			}
+			// Rewrite Success - Flash Data Is Valid And Up To Date.
+			vga_DrawString(4, 4, "FPGA Binary Updated And Valid.", RGB111_GREEN);
 		}
+
+		sprintf(szTempString, "%d Of %d Sectors Changed In %d ms", stats.m_uSectorsChanged, stats.m_uSectorsChecked, stats.m_uTimeMs);
+		vga_DrawString(4, 6, szTempString, bValid ? RGB111_GREEN : RGB111_RED);
+		sprintf(szTempString, "Erased 64K:%d 32K:%d 4K:%d", stats.m_uErase64k, stats.m_uErase32k, stats.m_uErase4k);
+		vga_DrawString(4, 8, szTempString, bValid ? RGB111_GREEN : RGB111_RED);
+		sprintf(szTempString, "Pages Programmed:%d Skipped:%d", stats.m_uPagesProgrammed, stats.m_uPagesSkipped);
+		vga_DrawString(4, 10, szTempString, bValid ? RGB111_GREEN : RGB111_RED);
 	}
 	else
 	{
@@ -100,66 +129,93 @@ int main()
 		sleep_ms(16);
 	}
 }
-*/
+
+#else
 
 //------------------------------------------------------------------------------------------------
 //---- Directly Upload BitStream To iCE40                                                     ----
 //------------------------------------------------------------------------------------------------
 int main()
 {
+	BootTimeline_Initialise(PIN_FPGA_CDONE);
 	stdio_init_all();
-    const u32 uSpiSpeed = spi_init(spi0, SPI_BAUD_RATE);
 
-    gpio_init(PIN_FPGA_RESET);
-    gpio_set_dir(PIN_FPGA_RESET, GPIO_OUT);
-    gpio_put(PIN_FPGA_RESET, false);
+	if (!iCE40Config_Initialise(spi0, ICE40_MAX_BAUD, ICE40_MIN_BAUD, PIN_SPI_CLOCK, PIN_SPI_MOSI, PIN_SPI_MISO, PIN_SPI_CS, PIN_FPGA_RESET, PIN_FPGA_CDONE))
+		panic("No free DMA channels for the iCE40 upload");
 
-    gpio_init(PIN_SPI_CS);
-    gpio_init(PIN_FPGA_CDONE);
-    gpio_set_dir(PIN_FPGA_CDONE, GPIO_IN);
+	BootTimeline_Mark(BOOT_MARK_CONFIG_READY);
 
-    gpio_set_function(PIN_SPI_CS, GPIO_FUNC_SIO);
-    gpio_set_function(PIN_SPI_CLOCK, GPIO_FUNC_SPI);
-    gpio_set_function(PIN_SPI_MOSI, GPIO_FUNC_SPI);
-    gpio_set_function(PIN_SPI_MISO, GPIO_FUNC_SPI);
-    gpio_set_dir(PIN_SPI_CS, GPIO_OUT);
-	gpio_put(PIN_SPI_CS, true);
+	// DMA Streams The Bitstream While The Display And Clock Are Brought Up
+	const bool bArchiveValid = iCE40Archive_Verify(iCE40_Archive, iCE40_Archive_end - iCE40_Archive, ICE40_ARCHIVE_SIZE, ICE40_ARCHIVE_CRC32);
+	const u32 uBitStream = iCE40Archive_SelectBoot(iCE40_Archive, PIN_BITSTREAM_STRAP, NUM_BITSTREAM_STRAPS);
+	const bool bUploading = bArchiveValid && iCE40Archive_UploadStart(iCE40_Archive, uBitStream);
 
 	vga_Init(PIN_RED, PIN_HSYNC, PIN_VSYNC);
 	vga_FilledRect(0, 0, VGA_RESOLUTION_X, VGA_RESOLUTION_Y, RGB111_GREEN);
 	vga_FilledRect(1, 1, VGA_RESOLUTION_X-2, VGA_RESOLUTION_Y-2, RGB111_BLACK);
-
-	// CS Low While Reset is Low to select Slave Mode.
-	sleep_ms(2);
-    gpio_put(PIN_SPI_CS, false);
-    gpio_put(PIN_FPGA_RESET, true);
-    sleep_us(1200);					// iCE40HX requires max 1200us clearing time
-
-    spi_write_blocking(spi0, iCE40_BitStream, iCE40_BitStream_size);
-    gpio_put(PIN_SPI_CS, true);
-
-    // iCE40 needs at least 49 cycles with CS high to enter user mode
-    uint8_t dummy_padding[8] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
-    spi_write_blocking(spi0, dummy_padding, sizeof(dummy_padding));
+	BootTimeline_Mark(BOOT_MARK_VGA_READY);
 
 	// Start Clock
 	clock_gpio_init(PIN_25MHZ_CLOCK, CLOCKS_CLK_GPOUT0_CTRL_AUXSRC_VALUE_CLK_SYS, ((float)SYS_CLK_HZ / (float)VGA_PAL_CLOCK));
+	BootTimeline_Mark(BOOT_MARK_CLOCK_READY);
+
+	// Falls Back To Slower SPI Clocks Until CDONE Rises
+	const bool bConfigured = bUploading && iCE40Config_UploadFinish();
+	const u32 uSpiSpeed = iCE40Config_GetBaudRate();
+	const iCE40ArchiveEntry* pEntry = iCE40Archive_GetEntry(iCE40_Archive, uBitStream);
+	char szTempString[128];
 
-	if( gpio_get(PIN_FPGA_CDONE) )
+	if (bConfigured)
 	{
-		vga_DrawString(4, 4, "Bitstream Upload Complete", RGB111_GREEN);
+		sprintf(szTempString, "Bitstream %d (%.12s) Upload Complete", uBitStream, pEntry->m_szName);
+		vga_DrawString(4, 4, szTempString, RGB111_GREEN);
+	}
+	else if (!bUploading)
+	{
+		sprintf(szTempString, "Bitstream %d Missing Or Corrupt!!!", uBitStream);
+		vga_DrawString(4, 4, szTempString, RGB111_RED);
 	}
 	else
 	{
 		vga_DrawString(4, 4, "FPGA Init Failed!!!", RGB111_RED);
 	}
 
-	// char szTempString[128];
-	// sprintf(szTempString, "Spi Speed %d", uSpiSpeed);
-	// vga_DrawString(4, 4, szTempString, RGB111_GREEN);
+	sprintf(szTempString, "Spi Speed %d.%d MHz", uSpiSpeed / 1000000, (uSpiSpeed / 100000) % 10);
+	vga_DrawString(4, 6, szTempString, bConfigured ? RGB111_GREEN : RGB111_RED);
+	vga_DrawString(4, 10, "Build " ICE40_ARCHIVE_BUILD_HASH, bArchiveValid ? RGB111_GREEN : RGB111_RED);
+
+	// Microseconds From main() For Each Stage, VGA Set Up Overlaps The Upload
+	BootTimeline_Draw(4, 12);
+	bool bTimelinePrinted = !FLASHSPI_BOOT_TIMELINE_STDIO;
 
 	while(true)
 	{
+		// Boot Is Long Over By The Time A Host Opens The Port, So Print It Then
+		if (!bTimelinePrinted && stdio_usb_connected())
+		{
+			BootTimeline_Print();
+			bTimelinePrinted = true;
+		}
+
+		// A Bitstream Sent By Tools/bitstream_reload.py Replaces The Running Design Until Reset
+		u32 uReloadLength;
+		switch (iCE40Reload_Poll(&uReloadLength))
+		{
+			case ICE40_RELOAD_CONFIGURED:
+				sprintf(szTempString, "USB Reload %d Bytes Complete   ", uReloadLength);
+				vga_DrawString(4, 8, szTempString, RGB111_GREEN);
+			break;
+
+			case ICE40_RELOAD_FAILED:
+				vga_DrawString(4, 8, "USB Reload Failed!!!           ", RGB111_RED);
+			break;
+
+			default:
+			break;
+		}
+
 		sleep_ms(16);
 	}
 }
+
+#endif
@@ -0,0 +1,416 @@
+//------------------------------------------------------------------------------------------------
+//---- SpiNorUpdate.c (C) 2023 Dave Gaunt                                                     ----
+//------------------------------------------------------------------------------------------------
+//---- The image is compared 4K sector by sector: the flash side is fast read by DMA through  ----
+//---- the sniffer, the new side is unpacked into RAM and run through the same CRC. Each 64K  ----
+//---- block is then erased with whichever mix of 4K, 32K and 64K erases costs the least      ----
+//---- time, counting the pages a larger erase forces us to program again. Sectors that are   ----
+//---- still blank only need programming, and pages that are all 0xFF are never programmed.   ----
+//------------------------------------------------------------------------------------------------
+
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/dma.h"
+
+#include "SpiNorUpdate.h"
+#include "iCE40Archive.h"
+#include "iCE40Unpack.h"
+
+#define SPINOR_CMD_PAGE_PROGRAM		(0x02)
+#define SPINOR_CMD_READ_STATUS		(0x05)
+#define SPINOR_CMD_WRITE_ENABLE		(0x06)
+#define SPINOR_CMD_FAST_READ		(0x0B)
+#define SPINOR_CMD_ERASE_4K			(0x20)
+#define SPINOR_CMD_ERASE_32K		(0x52)
+#define SPINOR_CMD_ERASE_64K		(0xD8)
+#define SPINOR_STATUS_BUSY			(0x01)
+
+#define SPINOR_PAGE_SIZE			(256)
+#define SPINOR_SECTOR_SIZE			(4096)
+#define SPINOR_BLOCK_SIZE			(65536)
+#define SPINOR_SECTORS_PER_BLOCK	(SPINOR_BLOCK_SIZE / SPINOR_SECTOR_SIZE)
+#define SPINOR_PAGES_PER_SECTOR		(SPINOR_SECTOR_SIZE / SPINOR_PAGE_SIZE)
+
+// Typical Datasheet Times (W25Q/IS25LP Class Parts), Only Their Ratios Matter
+#define SPINOR_ERASE_4K_US			(45000)
+#define SPINOR_ERASE_32K_US			(120000)
+#define SPINOR_ERASE_64K_US			(150000)
+#define SPINOR_PAGE_PROGRAM_US		(700)
+
+enum spinor_sector
+{
+	SPINOR_SECTOR_CLEAN = 0,					// Flash Already Matches The Image
+	SPINOR_SECTOR_PROGRAM,						// Flash Is Blank, Program Without Erasing
+	SPINOR_SECTOR_ERASE,						// Flash Differs, Erase Then Program
+	SPINOR_SECTOR_FREE,							// Past The Image And Blank, Safe To Erase
+	SPINOR_SECTOR_KEEP							// Past The Image And In Use, Never Erased
+};
+
+static spi_inst_t* s_pSpi = NULL;
+static u32 s_uPinCS;
+static int s_iTxChannel = -1;
+static int s_iRxChannel = -1;
+static u32 s_uBlankCrc32;						// CRC32 Of A Sector Of 0xFF
+
+static u8 s_aSector[SPINOR_SECTOR_SIZE] __attribute__((aligned(4)));
+
+static const u8* s_pSource;
+static bool s_bPacked;
+static u32 s_uLength;
+static iCE40Unpack s_unpack;
+
+//------------------------------------------------------------------------------------------------
+//---- SpiNorUpdate_Select                                                                    ----
+//------------------------------------------------------------------------------------------------
+static inline void SpiNorUpdate_Select(const u8 uCommand, const u32 uAddress)
+{
+	const u8 aCommand[4] = { uCommand, (u8)(uAddress >> 16), (u8)(uAddress >> 8), (u8)uAddress };
+
+	gpio_put(s_uPinCS, false);
+	spi_write_blocking(s_pSpi, aCommand, sizeof(aCommand));
+}
+
+//------------------------------------------------------------------------------------------------
+//---- SpiNorUpdate_WaitReady                                                                 ----
+//------------------------------------------------------------------------------------------------
+static void SpiNorUpdate_WaitReady(void)
+{
+	const u8 uCommand = SPINOR_CMD_READ_STATUS;
+	u8 uStatus;
+
+	gpio_put(s_uPinCS, false);
+	spi_write_blocking(s_pSpi, &uCommand, 1);
+
+	do
+	{
+		spi_read_blocking(s_pSpi, 0, &uStatus, 1);
+	}
+	while (uStatus & SPINOR_STATUS_BUSY);
+
+	gpio_put(s_uPinCS, true);
+}
+
+//------------------------------------------------------------------------------------------------
+//---- SpiNorUpdate_WriteEnable                                                               ----
+//------------------------------------------------------------------------------------------------
+static void SpiNorUpdate_WriteEnable(void)
+{
+	const u8 uCommand = SPINOR_CMD_WRITE_ENABLE;
+
+	gpio_put(s_uPinCS, false);
+	spi_write_blocking(s_pSpi, &uCommand, 1);
+	gpio_put(s_uPinCS, true);
+}
+
+//------------------------------------------------------------------------------------------------
+//---- SpiNorUpdate_Erase                                                                     ----
+//------------------------------------------------------------------------------------------------
+static void SpiNorUpdate_Erase(const u8 uCommand, const u32 uAddress)
+{
+	SpiNorUpdate_WriteEnable();
+	SpiNorUpdate_Select(uCommand, uAddress);
+	gpio_put(s_uPinCS, true);
+	SpiNorUpdate_WaitReady();
+}
+
+//------------------------------------------------------------------------------------------------
+//---- SpiNorUpdate_ProgramPage                                                               ----
+//------------------------------------------------------------------------------------------------
+static void SpiNorUpdate_ProgramPage(const u32 uAddress, const u8* pData)
+{
+	SpiNorUpdate_WriteEnable();
+	SpiNorUpdate_Select(SPINOR_CMD_PAGE_PROGRAM, uAddress);
+	spi_write_blocking(s_pSpi, pData, SPINOR_PAGE_SIZE);
+	gpio_put(s_uPinCS, true);
+	SpiNorUpdate_WaitReady();
+}
+
+//------------------------------------------------------------------------------------------------
+//---- SpiNorUpdate_FlashCrc32 - Fast read one sector through the DMA sniffer                ----
+//------------------------------------------------------------------------------------------------
+static u32 SpiNorUpdate_FlashCrc32(const u32 uAddress)
+{
+	static const u8 s_uDummy = 0;
+	static u8 s_uDiscard;
+
+	// spi_write_blocking Leaves The RX FIFO Empty, So Only Read Data Reaches The Sniffer
+	SpiNorUpdate_Select(SPINOR_CMD_FAST_READ, uAddress);
+	spi_write_blocking(s_pSpi, &s_uDummy, 1);
+
+	dma_channel_config config = dma_channel_get_default_config(s_iTxChannel);
+	channel_config_set_transfer_data_size(&config, DMA_SIZE_8);
+	channel_config_set_read_increment(&config, false);
+	channel_config_set_write_increment(&config, false);
+	channel_config_set_dreq(&config, spi_get_dreq(s_pSpi, true));
+	dma_channel_configure(s_iTxChannel, &config, &spi_get_hw(s_pSpi)->dr, &s_uDummy, SPINOR_SECTOR_SIZE, false);
+
+	config = dma_channel_get_default_config(s_iRxChannel);
+	channel_config_set_transfer_data_size(&config, DMA_SIZE_8);
+	channel_config_set_read_increment(&config, false);
+	channel_config_set_write_increment(&config, false);
+	channel_config_set_dreq(&config, spi_get_dreq(s_pSpi, false));
+	channel_config_set_sniff_enable(&config, true);
+	dma_channel_configure(s_iRxChannel, &config, &s_uDiscard, &spi_get_hw(s_pSpi)->dr, SPINOR_SECTOR_SIZE, false);
+
+	// Same Set Up As iCE40Archive_Crc32 So The Two Can Be Compared
+	dma_sniffer_enable(s_iRxChannel, DMA_SNIFF_CTRL_CALC_VALUE_CRC32R, true);
+	dma_sniffer_set_output_reverse_enabled(true);
+	dma_sniffer_set_output_invert_enabled(true);
+	dma_sniffer_set_data_accumulator(0xFFFFFFFF);
+
+	dma_start_channel_mask((1u << s_iTxChannel) | (1u << s_iRxChannel));
+	dma_channel_wait_for_finish_blocking(s_iRxChannel);
+	gpio_put(s_uPinCS, true);
+
+	const u32 uCrc32 = dma_sniffer_get_data_accumulator();
+	dma_sniffer_disable();
+	return uCrc32;
+}
+
+//------------------------------------------------------------------------------------------------
+//---- SpiNorUpdate_FillSector - Next sector of the image into s_aSector, 0xFF past the end  ----
+//------------------------------------------------------------------------------------------------
+static void SpiNorUpdate_FillSector(const u32 uOffset)
+{
+	const u32 uBytes = ((s_uLength - uOffset) < SPINOR_SECTOR_SIZE) ? (s_uLength - uOffset) : SPINOR_SECTOR_SIZE;
+	u32 uFilled = uBytes;
+
+	if (s_bPacked)
+	{
+		uFilled = iCE40Unpack_Read(&s_unpack, s_aSector, uBytes);
+	}
+	else
+	{
+		memcpy(s_aSector, s_pSource + uOffset, uBytes);
+	}
+
+	memset(&s_aSector[uFilled], 0xFF, SPINOR_SECTOR_SIZE - uFilled);
+}
+
+//------------------------------------------------------------------------------------------------
+//---- SpiNorUpdate_ReprogramCost - Time to put clean sectors back after a larger erase      ----
+//------------------------------------------------------------------------------------------------
+static u32 SpiNorUpdate_ReprogramCost(const u8* pState, const u32* pCrc32, const u32 uCount, bool* pbAllowed)
+{
+	u32 uCost = 0;
+
+	for (u32 i=0; i<uCount; ++i)
+	{
+		if (SPINOR_SECTOR_KEEP == pState[i])
+			*pbAllowed = false;
+
+		if ((SPINOR_SECTOR_CLEAN == pState[i]) && (pCrc32[i] != s_uBlankCrc32))
+			uCost += SPINOR_PAGES_PER_SECTOR * SPINOR_PAGE_PROGRAM_US;
+	}
+
+	return uCost;
+}
+
+//------------------------------------------------------------------------------------------------
+//---- SpiNorUpdate_EraseHalf - Cheapest of one 32K erase or 4K erases of the dirty sectors  ----
+//------------------------------------------------------------------------------------------------
+static u32 SpiNorUpdate_EraseHalf(const u32 uAddress, u8* pState, const u32* pCrc32, const bool bApply, SpiNorUpdateStats* pStats)
+{
+	const u32 uHalfSectors = SPINOR_SECTORS_PER_BLOCK / 2;
+	u32 uDirty = 0;
+
+	for (u32 i=0; i<uHalfSectors; ++i)
+	{
+		if (SPINOR_SECTOR_ERASE == pState[i])
+			++uDirty;
+	}
+
+	if (0 == uDirty)
+		return 0;
+
+	bool bAllowed = true;
+	const u32 uCost32k = SPINOR_ERASE_32K_US + SpiNorUpdate_ReprogramCost(pState, pCrc32, uHalfSectors, &bAllowed);
+	const u32 uCost4k = uDirty * SPINOR_ERASE_4K_US;
+
+	if (bAllowed && (uCost32k < uCost4k))
+	{
+		if (bApply)
+		{
+			SpiNorUpdate_Erase(SPINOR_CMD_ERASE_32K, uAddress);
+			++pStats->m_uErase32k;
+
+			for (u32 i=0; i<uHalfSectors; ++i)
+			{
+				if ((SPINOR_SECTOR_CLEAN == pState[i]) || (SPINOR_SECTOR_ERASE == pState[i]))
+					pState[i] = SPINOR_SECTOR_PROGRAM;
+			}
+		}
+
+		return uCost32k;
+	}
+
+	if (bApply)
+	{
+		for (u32 i=0; i<uHalfSectors; ++i)
+		{
+			if (SPINOR_SECTOR_ERASE == pState[i])
+			{
+				SpiNorUpdate_Erase(SPINOR_CMD_ERASE_4K, uAddress + (i * SPINOR_SECTOR_SIZE));
+				++pStats->m_uErase4k;
+				pState[i] = SPINOR_SECTOR_PROGRAM;
+			}
+		}
+	}
+
+	return uCost4k;
+}
+
+//------------------------------------------------------------------------------------------------
+//---- SpiNorUpdate_Block - Compare, erase and program one 64K block                          ----
+//------------------------------------------------------------------------------------------------
+static bool SpiNorUpdate_Block(const u32 uAddress, const u32 uOffset, SpiNorUpdateStats* pStats)
+{
+	u8 aState[SPINOR_SECTORS_PER_BLOCK];
+	u32 aCrc32[SPINOR_SECTORS_PER_BLOCK];
+	const iCE40Unpack blockUnpack = s_unpack;	// Replayed For The Program Pass
+	bool bChanged = false;
+
+	for (u32 i=0; i<SPINOR_SECTORS_PER_BLOCK; ++i)
+	{
+		const u32 uSectorOffset = uOffset + (i * SPINOR_SECTOR_SIZE);
+		const u32 uFlashCrc32 = SpiNorUpdate_FlashCrc32(uAddress + (i * SPINOR_SECTOR_SIZE));
+
+		if (uSectorOffset >= s_uLength)
+		{
+			aState[i] = (uFlashCrc32 == s_uBlankCrc32) ? SPINOR_SECTOR_FREE : SPINOR_SECTOR_KEEP;
+			aCrc32[i] = s_uBlankCrc32;
+			continue;
+		}
+
+		SpiNorUpdate_FillSector(uSectorOffset);
+		aCrc32[i] = iCE40Archive_Crc32(s_aSector, SPINOR_SECTOR_SIZE);
+		++pStats->m_uSectorsChecked;
+
+		if (uFlashCrc32 == aCrc32[i])
+		{
+			aState[i] = SPINOR_SECTOR_CLEAN;
+			continue;
+		}
+
+		aState[i] = (uFlashCrc32 == s_uBlankCrc32) ? SPINOR_SECTOR_PROGRAM : SPINOR_SECTOR_ERASE;
+		++pStats->m_uSectorsChanged;
+		bChanged = true;
+	}
+
+	if (!bChanged)
+		return true;
+
+	// One 64K Erase Against The Best Of Each 32K Half
+	const u32 uHalfSectors = SPINOR_SECTORS_PER_BLOCK / 2;
+	const u32 uCostHalves = SpiNorUpdate_EraseHalf(uAddress, aState, aCrc32, false, pStats) +
+							SpiNorUpdate_EraseHalf(uAddress + (SPINOR_BLOCK_SIZE / 2), &aState[uHalfSectors], &aCrc32[uHalfSectors], false, pStats);
+	bool bAllowed = true;
+	const u32 uCost64k = SPINOR_ERASE_64K_US + SpiNorUpdate_ReprogramCost(aState, aCrc32, SPINOR_SECTORS_PER_BLOCK, &bAllowed);
+
+	if (bAllowed && (uCost64k < uCostHalves))
+	{
+		SpiNorUpdate_Erase(SPINOR_CMD_ERASE_64K, uAddress);
+		++pStats->m_uErase64k;
+
+		for (u32 i=0; i<SPINOR_SECTORS_PER_BLOCK; ++i)
+		{
+			if ((SPINOR_SECTOR_CLEAN == aState[i]) || (SPINOR_SECTOR_ERASE == aState[i]))
+				aState[i] = SPINOR_SECTOR_PROGRAM;
+		}
+	}
+	else if (uCostHalves)
+	{
+		SpiNorUpdate_EraseHalf(uAddress, aState, aCrc32, true, pStats);
+		SpiNorUpdate_EraseHalf(uAddress + (SPINOR_BLOCK_SIZE / 2), &aState[uHalfSectors], &aCrc32[uHalfSectors], true, pStats);
+	}
+
+	// Second Pass Unpacks The Block Again, Programs What Changed And Reads It Back
+	s_unpack = blockUnpack;
+
+	for (u32 i=0; i<SPINOR_SECTORS_PER_BLOCK; ++i)
+	{
+		const u32 uSectorOffset = uOffset + (i * SPINOR_SECTOR_SIZE);
+		const u32 uSectorAddress = uAddress + (i * SPINOR_SECTOR_SIZE);
+
+		if (uSectorOffset >= s_uLength)
+			break;
+
+		SpiNorUpdate_FillSector(uSectorOffset);
+
+		if (SPINOR_SECTOR_PROGRAM != aState[i])
+			continue;
+
+		for (u32 uPage=0; uPage<SPINOR_SECTOR_SIZE; uPage+=SPINOR_PAGE_SIZE)
+		{
+			const u8* pPage = &s_aSector[uPage];
+			u32 uAnd = 0xFF;
+
+			for (u32 j=0; j<SPINOR_PAGE_SIZE; ++j)
+				uAnd &= pPage[j];
+
+			if (0xFF == uAnd)
+			{
+				++pStats->m_uPagesSkipped;
+				continue;
+			}
+
+			SpiNorUpdate_ProgramPage(uSectorAddress + uPage, pPage);
+			++pStats->m_uPagesProgrammed;
+		}
+
+		if (SpiNorUpdate_FlashCrc32(uSectorAddress) != aCrc32[i])
+			return false;
+	}
+
+	return true;
+}
+
+//------------------------------------------------------------------------------------------------
+//---- SpiNorUpdate_Initialise                                                                ----
+//------------------------------------------------------------------------------------------------
+bool SpiNorUpdate_Initialise(spi_inst_t* pSpi, const u32 uPinCS)
+{
+	s_pSpi = pSpi;
+	s_uPinCS = uPinCS;
+
+	gpio_init(s_uPinCS);
+	gpio_put(s_uPinCS, true);
+	gpio_set_dir(s_uPinCS, GPIO_OUT);
+
+	if (s_iTxChannel < 0)
+		s_iTxChannel = dma_claim_unused_channel(false);
+
+	if (s_iRxChannel < 0)
+		s_iRxChannel = dma_claim_unused_channel(false);
+
+	if ((s_iTxChannel < 0) || (s_iRxChannel < 0))
+		return false;
+
+	memset(s_aSector, 0xFF, sizeof(s_aSector));
+	s_uBlankCrc32 = iCE40Archive_Crc32(s_aSector, sizeof(s_aSector));
+	return true;
+}
+
+//------------------------------------------------------------------------------------------------
+//---- SpiNorUpdate_Image                                                                     ----
+//------------------------------------------------------------------------------------------------
+bool SpiNorUpdate_Image(const u32 uAddress, const u8* pSource, const u32 uSourceSize, const u32 uLength, const bool bPacked, SpiNorUpdateStats* pStats)
+{
+	const u32 uStartMs = to_ms_since_boot(get_absolute_time());
+	bool bVerified = true;
+
+	memset(pStats, 0, sizeof(*pStats));
+
+	s_pSource = pSource;
+	s_bPacked = bPacked;
+	s_uLength = uLength;
+
+	if (bPacked)
+		iCE40Unpack_Begin(&s_unpack, pSource, uSourceSize);
+
+	for (u32 uOffset=0; (uOffset < uLength) && bVerified; uOffset+=SPINOR_BLOCK_SIZE)
+		bVerified = SpiNorUpdate_Block(uAddress + uOffset, uOffset, pStats);
+
+	pStats->m_uTimeMs = to_ms_since_boot(get_absolute_time()) - uStartMs;
+	return bVerified;
+}
@@ -0,0 +1,29 @@
+//------------------------------------------------------------------------------------------------
+//---- SpiNorUpdate.h (C) 2023 Dave Gaunt                                                     ----
+//------------------------------------------------------------------------------------------------
+//---- Brings The FPGA's SPI NOR Flash Up To Date, Touching Only The Sectors That Differ      ----
+//------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "types.h"
+#include "hardware/spi.h"
+
+typedef struct
+{
+	u32		m_uSectorsChecked;
+	u32		m_uSectorsChanged;				// Differed From The Image
+	u32		m_uErase4k;
+	u32		m_uErase32k;
+	u32		m_uErase64k;
+	u32		m_uPagesProgrammed;
+	u32		m_uPagesSkipped;				// All 0xFF, Left Erased
+	u32		m_uTimeMs;
+} SpiNorUpdateStats;
+
+// Call After SpiNorFlash_Initialise, The SPI Must Already Be Set Up. CS Is Driven As A GPIO.
+bool SpiNorUpdate_Initialise(spi_inst_t* pSpi, const u32 uPinCS);
+
+// uAddress Must Be 64K Aligned. pSource Is uSourceSize Bytes, Zero Run Packed When bPacked Is Set,
+// That Unpack To uLength Bytes. Returns True Once Every Sector Of The Image Reads Back Correctly.
+bool SpiNorUpdate_Image(const u32 uAddress, const u8* pSource, const u32 uSourceSize, const u32 uLength, const bool bPacked, SpiNorUpdateStats* pStats);
@@ -0,0 +1,124 @@
+#!/usr/bin/env python3
+#------------------------------------------------------------------------------------------------
+#---- bitstream_archive.py - Pack several iCE40 bitstreams into one indexed archive          ----
+#------------------------------------------------------------------------------------------------
+#---- Layout (little endian, payloads 4 byte aligned so raw ones can use the XIP stream):    ----
+#----                                                                                        ----
+#----   u32 magic "I40A"   u16 version   u8 count   u8 default index                         ----
+#----   count x { u32 offset, u32 size, u32 length, u32 crc32, u32 flags, char name[12] }    ----
+#----   payloads                                                                             ----
+#----                                                                                        ----
+#---- offset is from the start of the archive, size is the stored size, length the size     ----
+#---- the FPGA sees, crc32 (zlib) covers the stored bytes. Flag bit 0 marks a payload packed ----
+#---- with bitstream_pack.py, which is only used when it is actually smaller.                ----
+#----                                                                                        ----
+#---- Must match iCE40Archive.h.                                                             ----
+#----                                                                                        ----
+#---- The archive is written as a raw .bin that iCE40_Archive.S pulls in with .incbin, plus  ----
+#---- a small header giving its size, CRC32 and a build hash for the firmware to check.      ----
+#------------------------------------------------------------------------------------------------
+
+import argparse
+import hashlib
+import os
+import struct
+import sys
+import zlib
+
+from bitstream_pack import pack, read_bitstream, unpack
+
+MAGIC = 0x41303449          # "I40A"
+VERSION = 1
+HEADER_SIZE = 8
+ENTRY_SIZE = 32
+NAME_SIZE = 12
+FLAG_PACKED = 0x01
+
+
+#------------------------------------------------------------------------------------------------
+#---- build_archive                                                                          ----
+#------------------------------------------------------------------------------------------------
+def build_archive(bitstreams, default_index):
+	if not 0 < len(bitstreams) <= 255:
+		raise ValueError("an archive holds 1..255 bitstreams")
+	if not 0 <= default_index < len(bitstreams):
+		raise ValueError("default index %d is out of range" % default_index)
+
+	table = bytearray()
+	payloads = bytearray()
+	offset = HEADER_SIZE + ENTRY_SIZE * len(bitstreams)
+
+	for name, data in bitstreams:
+		packed = pack(data)
+		if unpack(packed) != data:
+			raise ValueError("%s does not round trip through the packer" % name)
+
+		stored, flags = (packed, FLAG_PACKED) if len(packed) < len(data) else (data, 0)
+
+		table += struct.pack("<IIIII", offset, len(stored), len(data), zlib.crc32(stored), flags)
+		table += name.encode("ascii")[:NAME_SIZE - 1].ljust(NAME_SIZE, b"\0")
+
+		payloads += stored
+		padding = (-len(stored)) % 4
+		payloads += bytes(padding)
+		offset += len(stored) + padding
+
+	return struct.pack("<IHBB", MAGIC, VERSION, len(bitstreams), default_index) + table + payloads
+
+
+#------------------------------------------------------------------------------------------------
+#---- write_metadata                                                                         ----
+#------------------------------------------------------------------------------------------------
+def write_metadata(path, name, bitstreams, archive):
+	prefix = name.upper()
+	lines = [
+		"/* Generated by bitstream_archive.py, do not edit manually */",
+		"",
+		"/* %s */" % ", ".join("%d: %s (%d bytes)" % (i, n, len(d)) for i, (n, d) in enumerate(bitstreams)),
+		"#pragma once",
+		"",
+		"#define %s_SIZE\t\t\t(%d)" % (prefix, len(archive)),
+		"#define %s_CRC32\t\t(0x%08XU)\t\t/* zlib CRC32 Of The Whole Archive */" % (prefix, zlib.crc32(archive)),
+		"#define %s_BUILD_HASH\t\"%s\"\t/* SHA-1 Of The Archive, First 12 Digits */" % (prefix, hashlib.sha1(archive).hexdigest()[:12]),
+		"",
+		"/* Linked In By iCE40_Archive.S */",
+		"extern const unsigned char %s[];" % name,
+		"extern const unsigned char %s_end[];" % name,
+	]
+
+	with open(path, "w", newline="\n") as f:
+		f.write("\n".join(lines) + "\n")
+
+
+#------------------------------------------------------------------------------------------------
+#---- main                                                                                   ----
+#------------------------------------------------------------------------------------------------
+def main():
+	parser = argparse.ArgumentParser(description="Build the FlashSPI bitstream archive.")
+	parser.add_argument("output", help="raw archive .bin to write")
+	parser.add_argument("bitstreams", nargs="+", metavar="[NAME=]FILE", help="Hardware.bin or bin2c header, in index order")
+	parser.add_argument("--default", type=int, default=0, help="index booted when no strap is fitted")
+	parser.add_argument("--header", required=True, help="metadata C header to write")
+	parser.add_argument("--name", default="iCE40_Archive", help="C symbol name, must match iCE40_Archive.S")
+	args = parser.parse_args()
+
+	bitstreams = []
+	for spec in args.bitstreams:
+		name, _, path = spec.rpartition("=")
+		if not name:
+			name = os.path.splitext(os.path.basename(path))[0]
+		bitstreams.append((name, read_bitstream(path)))
+
+	try:
+		archive = build_archive(bitstreams, args.default)
+	except ValueError as e:
+		sys.exit("bitstream_archive.py: %s" % e)
+
+	with open(args.output, "wb") as f:
+		f.write(archive)
+
+	write_metadata(args.header, args.name, bitstreams, archive)
+
+
+if __name__ == "__main__":
+	main()
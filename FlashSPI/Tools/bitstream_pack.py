@@ -0,0 +1,93 @@
+#------------------------------------------------------------------------------------------------
+#---- bitstream_pack.py - Zero run RLE for iCE40 bitstreams                                  ----
+#------------------------------------------------------------------------------------------------
+#---- iCE40 bitstreams are mostly long runs of 0x00 (the VIC core is ~96% zeros), so a byte  ----
+#---- oriented RLE that only encodes zero runs gets >10:1 and unpacks at memset speed.       ----
+#----                                                                                        ----
+#----   0LLLLLLL            L+1 literal bytes follow (1..128)                                ----
+#----   10LLLLLL            L+1 zero bytes (1..64)                                           ----
+#----   11LLLLLL llllllll   (L << 8 | l) + 65 zero bytes (65..16448)                         ----
+#----                                                                                        ----
+#---- Must match iCE40Unpack_Read() in iCE40Unpack.c. Only a library, bitstream_archive.py   ----
+#---- and bitstream_reload.py do the packing.                                                ----
+#------------------------------------------------------------------------------------------------
+
+import re
+
+MAX_LITERAL = 128
+MAX_SHORT_ZERO = 64
+MAX_LONG_ZERO = 0x3FFF + 65
+
+
+#------------------------------------------------------------------------------------------------
+#---- pack                                                                                   ----
+#------------------------------------------------------------------------------------------------
+def pack(data):
+	out = bytearray()
+	literal = bytearray()
+
+	def flush_literal():
+		for start in range(0, len(literal), MAX_LITERAL):
+			chunk = literal[start:start + MAX_LITERAL]
+			out.append(len(chunk) - 1)
+			out.extend(chunk)
+		literal.clear()
+
+	i = 0
+	while i < len(data):
+		if data[i] == 0:
+			run = 1
+			while (i + run < len(data)) and (data[i + run] == 0) and (run < MAX_LONG_ZERO):
+				run += 1
+
+			# A lone zero is cheaper left inside a literal run than as a token of its own.
+			if run >= 2 or not literal:
+				flush_literal()
+				if run <= MAX_SHORT_ZERO:
+					out.append(0x80 | (run - 1))
+				else:
+					out.append(0xC0 | ((run - 65) >> 8))
+					out.append((run - 65) & 0xFF)
+				i += run
+				continue
+
+		literal.append(data[i])
+		i += 1
+
+	flush_literal()
+	return bytes(out)
+
+
+#------------------------------------------------------------------------------------------------
+#---- unpack                                                                                 ----
+#------------------------------------------------------------------------------------------------
+def unpack(packed):
+	out = bytearray()
+	i = 0
+	while i < len(packed):
+		token = packed[i]
+		i += 1
+		if token < 0x80:
+			out.extend(packed[i:i + token + 1])
+			i += token + 1
+		elif token < 0xC0:
+			out.extend(bytes((token & 0x3F) + 1))
+		else:
+			out.extend(bytes((((token & 0x3F) << 8) | packed[i]) + 65))
+			i += 1
+	return bytes(out)
+
+
+#------------------------------------------------------------------------------------------------
+#---- read_bitstream - Raw .bin, or the bin2c header the FPGA build used to hand over         ----
+#------------------------------------------------------------------------------------------------
+def read_bitstream(path):
+	with open(path, "rb") as f:
+		data = f.read()
+
+	if not path.lower().endswith(".h"):
+		return data
+
+	text = data.decode("ascii")
+	body = text[text.index("{") + 1:text.rindex("}")]
+	return bytes(int(value, 16) for value in re.findall(r"0x([0-9A-Fa-f]{2})", body))
@@ -0,0 +1,173 @@
+#!/usr/bin/env python3
+#------------------------------------------------------------------------------------------------
+#---- bitstream_reload.py - Send a bitstream to FlashSPI over USB CDC                        ----
+#------------------------------------------------------------------------------------------------
+#---- FlashSPI keeps it in RAM, reconfigures the iCE40 from it and answers with one line,    ----
+#---- "OK CDONE=1 SPI=<hz>" or "ERR <reason>". The design runs until the next reset.        ----
+#----                                                                                        ----
+#----   bitstream_reload.py /dev/ttyACM0 Hardware.bin                                        ----
+#----   bitstream_reload.py --loopback Hardware.bin      (no board, checks the protocol)     ----
+#----                                                                                        ----
+#---- Header is iCE40ReloadHeader from iCE40Reload.h: u32 magic "I40L", size, length, crc32, ----
+#---- flags, all little endian. The payload is packed with bitstream_pack.py when smaller.    ----
+#------------------------------------------------------------------------------------------------
+
+import argparse
+import os
+import struct
+import sys
+import termios
+import threading
+import time
+import tty
+import zlib
+
+from bitstream_pack import pack, read_bitstream, unpack
+
+MAGIC = 0x4C303449          # "I40L"
+HEADER = struct.Struct("<IIIII")
+FLAG_PACKED = 0x01
+MAX_SIZE = 136 * 1024       # ICE40_RELOAD_MAX_SIZE
+
+
+#------------------------------------------------------------------------------------------------
+#---- build_message                                                                          ----
+#------------------------------------------------------------------------------------------------
+def build_message(data, allow_pack=True):
+	payload, flags = data, 0
+
+	if allow_pack:
+		packed = pack(data)
+		if len(packed) < len(data):
+			payload, flags = packed, FLAG_PACKED
+
+	if len(payload) > MAX_SIZE:
+		raise ValueError("bitstream is %d bytes, FlashSPI only has room for %d" % (len(payload), MAX_SIZE))
+
+	return HEADER.pack(MAGIC, len(payload), len(data), zlib.crc32(payload), flags) + payload
+
+
+#------------------------------------------------------------------------------------------------
+#---- open_port - Raw tty, no pyserial needed                                                ----
+#------------------------------------------------------------------------------------------------
+def open_port(path):
+	fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+	tty.setraw(fd)
+	attributes = termios.tcgetattr(fd)
+	attributes[6][termios.VMIN] = 0
+	attributes[6][termios.VTIME] = 1
+	termios.tcsetattr(fd, termios.TCSANOW, attributes)
+	termios.tcflush(fd, termios.TCIOFLUSH)
+	return fd
+
+
+#------------------------------------------------------------------------------------------------
+#---- send                                                                                   ----
+#------------------------------------------------------------------------------------------------
+def send(fd, message, timeout):
+	view = memoryview(message)
+	while view:
+		written = os.write(fd, view)
+		view = view[written:]
+
+	reply = bytearray()
+	deadline = time.monotonic() + timeout
+	while time.monotonic() < deadline:
+		chunk = os.read(fd, 64)
+		reply += chunk
+
+		# Anything before the reply line is left over stdio output, only the last line counts.
+		if b"\n" in reply:
+			lines = reply.replace(b"\r", b"").split(b"\n")
+			for line in reversed(lines[:-1]):
+				if line.startswith(b"OK") or line.startswith(b"ERR"):
+					return line.decode("ascii")
+
+	return "ERR NO REPLY"
+
+
+#------------------------------------------------------------------------------------------------
+#---- LoopbackDevice - Stands in for iCE40Reload_Poll on the other end of a pty             ----
+#------------------------------------------------------------------------------------------------
+class LoopbackDevice(threading.Thread):
+	def __init__(self, fd):
+		super().__init__(daemon=True)
+		self.fd = fd
+
+	def read_exact(self, count):
+		data = bytearray()
+		while len(data) < count:
+			chunk = os.read(self.fd, count - len(data))
+			if not chunk:
+				raise EOFError
+			data += chunk
+		return bytes(data)
+
+	def reply(self, line):
+		os.write(self.fd, (line + "\r\n").encode("ascii"))
+
+	def run(self):
+		shift = 0
+		try:
+			while True:
+				shift = (shift >> 8) | (self.read_exact(1)[0] << 24)
+				if shift != MAGIC:
+					continue
+				shift = 0
+
+				_, size, length, crc32, flags = HEADER.unpack(struct.pack("<I", MAGIC) + self.read_exact(HEADER.size - 4))
+				if size == 0 or size > MAX_SIZE or (not flags & FLAG_PACKED and length != size):
+					self.reply("ERR SIZE")
+					continue
+
+				payload = self.read_exact(size)
+				if zlib.crc32(payload) != crc32:
+					self.reply("ERR CRC")
+					continue
+
+				# The FPGA would see the unpacked stream, make sure it is the promised length.
+				data = unpack(payload) if flags & FLAG_PACKED else payload
+				if len(data) != length:
+					self.reply("ERR CDONE=0 SPI=0")
+					continue
+
+				self.reply("OK CDONE=1 SPI=0")
+		except (EOFError, OSError):
+			pass
+
+
+#------------------------------------------------------------------------------------------------
+#---- main                                                                                   ----
+#------------------------------------------------------------------------------------------------
+def main():
+	parser = argparse.ArgumentParser(description="Hot reload an iCE40 bitstream through FlashSPI.")
+	parser.add_argument("port", nargs="?", help="FlashSPI's USB CDC port, e.g. /dev/ttyACM0")
+	parser.add_argument("bitstream", help="Hardware.bin, or a bin2c header of it")
+	parser.add_argument("--loopback", action="store_true", help="talk to a stand-in on a pty instead of a board")
+	parser.add_argument("--raw", action="store_true", help="send unpacked")
+	parser.add_argument("--timeout", type=float, default=5.0, help="seconds to wait for CDONE to be reported")
+	args = parser.parse_args()
+
+	if not args.loopback and not args.port:
+		parser.error("a port is needed unless --loopback is given")
+
+	try:
+		message = build_message(read_bitstream(args.bitstream), not args.raw)
+	except ValueError as e:
+		sys.exit("bitstream_reload.py: %s" % e)
+
+	if args.loopback:
+		master, slave = os.openpty()
+		LoopbackDevice(master).start()
+		fd = open_port(os.ttyname(slave))
+	else:
+		fd = open_port(args.port)
+
+	start = time.monotonic()
+	reply = send(fd, message, args.timeout)
+	print("%s (%d bytes in %.2fs)" % (reply, len(message), time.monotonic() - start))
+	sys.exit(0 if reply.startswith("OK") else 1)
+
+
+if __name__ == "__main__":
+	main()
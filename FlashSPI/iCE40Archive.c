@@ -0,0 +1,127 @@
+//------------------------------------------------------------------------------------------------
+//---- iCE40Archive.c (C) 2023 Dave Gaunt                                                     ----
+//------------------------------------------------------------------------------------------------
+
+#include "pico/stdlib.h"
+#include "hardware/dma.h"
+
+#include "iCE40Archive.h"
+#include "iCE40Config.h"
+
+//------------------------------------------------------------------------------------------------
+//---- iCE40Archive_Crc32 - zlib CRC32 using the DMA sniffer                                  ----
+//------------------------------------------------------------------------------------------------
+u32 iCE40Archive_Crc32(const u8* pData, const u32 uLength)
+{
+	static u32 s_uDiscard;
+	const int iChannel = dma_claim_unused_channel(true);
+
+	dma_channel_config config = dma_channel_get_default_config(iChannel);
+	channel_config_set_transfer_data_size(&config, DMA_SIZE_8);
+	channel_config_set_read_increment(&config, true);
+	channel_config_set_write_increment(&config, false);
+	channel_config_set_sniff_enable(&config, true);
+
+	// Bit Reversed In And Out, Seeded And Inverted Gives The Same Answer As zlib
+	dma_sniffer_enable(iChannel, DMA_SNIFF_CTRL_CALC_VALUE_CRC32R, true);
+	dma_sniffer_set_output_reverse_enabled(true);
+	dma_sniffer_set_output_invert_enabled(true);
+	dma_sniffer_set_data_accumulator(0xFFFFFFFF);
+
+	dma_channel_configure(iChannel, &config, &s_uDiscard, pData, uLength, true);
+	dma_channel_wait_for_finish_blocking(iChannel);
+
+	const u32 uCrc32 = dma_sniffer_get_data_accumulator();
+	dma_sniffer_disable();
+	dma_channel_unclaim(iChannel);
+	return uCrc32;
+}
+
+//------------------------------------------------------------------------------------------------
+//---- iCE40Archive_Verify                                                                    ----
+//------------------------------------------------------------------------------------------------
+bool iCE40Archive_Verify(const u8* pArchive, const u32 uLinkedSize, const u32 uSize, const u32 uCrc32)
+{
+	// A Stale Object Or Truncated Link Shows Up As A Size Mismatch Before Any CRC Is Run
+	if ((uLinkedSize != uSize) || (uSize < sizeof(iCE40ArchiveHeader)))
+		return false;
+
+	const iCE40ArchiveHeader* pHeader = (const iCE40ArchiveHeader*)pArchive;
+
+	if ((ICE40_ARCHIVE_MAGIC != pHeader->m_uMagic) || (ICE40_ARCHIVE_VERSION != pHeader->m_uVersion))
+		return false;
+
+	return iCE40Archive_Crc32(pArchive, uSize) == uCrc32;
+}
+
+//------------------------------------------------------------------------------------------------
+//---- iCE40Archive_GetEntry                                                                  ----
+//------------------------------------------------------------------------------------------------
+const iCE40ArchiveEntry* iCE40Archive_GetEntry(const u8* pArchive, const u32 uIndex)
+{
+	const iCE40ArchiveHeader* pHeader = (const iCE40ArchiveHeader*)pArchive;
+
+	if ((ICE40_ARCHIVE_MAGIC != pHeader->m_uMagic) || (ICE40_ARCHIVE_VERSION != pHeader->m_uVersion))
+		return NULL;
+
+	if (uIndex >= pHeader->m_uCount)
+		return NULL;
+
+	return &pHeader->m_entry[uIndex];
+}
+
+//------------------------------------------------------------------------------------------------
+//---- iCE40Archive_SelectBoot                                                                ----
+//------------------------------------------------------------------------------------------------
+u32 iCE40Archive_SelectBoot(const u8* pArchive, const u32 uPinStrap, const u32 uNumStraps)
+{
+	u32 uStraps = 0;
+
+	for (u32 i=0; i<uNumStraps; ++i)
+	{
+		gpio_init(uPinStrap + i);
+		gpio_set_dir(uPinStrap + i, GPIO_IN);
+		gpio_pull_up(uPinStrap + i);
+	}
+
+	sleep_us(10);					// Let The Pull Ups Charge The Pins
+
+	for (u32 i=0; i<uNumStraps; ++i)
+	{
+		if (!gpio_get(uPinStrap + i))
+			uStraps |= (1 << i);
+
+		gpio_disable_pulls(uPinStrap + i);
+	}
+
+	if (uStraps)
+		return uStraps;
+
+	const iCE40ArchiveHeader* pHeader = (const iCE40ArchiveHeader*)pArchive;
+	return pHeader->m_uDefaultIndex;
+}
+
+//------------------------------------------------------------------------------------------------
+//---- iCE40Archive_UploadStart                                                               ----
+//------------------------------------------------------------------------------------------------
+bool iCE40Archive_UploadStart(const u8* pArchive, const u32 uIndex)
+{
+	const iCE40ArchiveEntry* pEntry = iCE40Archive_GetEntry(pArchive, uIndex);
+
+	if (NULL == pEntry)
+		return false;
+
+	// iCE40Archive_Verify Has Already CRC'd The Whole Archive, So The Entry's Own CRC Isn't Rerun
+	const u8* pPayload = pArchive + pEntry->m_uOffset;
+
+	if (pEntry->m_uFlags & ICE40_ARCHIVE_FLAG_PACKED)
+	{
+		iCE40Config_UploadPackedStart(pPayload, pEntry->m_uSize, pEntry->m_uLength);
+	}
+	else
+	{
+		iCE40Config_UploadStart(pPayload, pEntry->m_uLength);
+	}
+
+	return true;
+}
@@ -0,0 +1,52 @@
+//------------------------------------------------------------------------------------------------
+//---- iCE40Archive.h (C) 2023 Dave Gaunt                                                     ----
+//------------------------------------------------------------------------------------------------
+//---- Indexed Set Of Bitstreams Built By Tools/bitstream_archive.py                          ----
+//------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "types.h"
+
+#define ICE40_ARCHIVE_MAGIC			(0x41303449)		// "I40A"
+#define ICE40_ARCHIVE_VERSION		(1)
+#define ICE40_ARCHIVE_FLAG_PACKED	(0x01)				// Zero Run RLE, See Tools/bitstream_pack.py
+#define ICE40_ARCHIVE_NAME_SIZE		(12)
+
+typedef struct
+{
+	u32		m_uOffset;						// From The Start Of The Archive, 4 Byte Aligned
+	u32		m_uSize;						// Stored Bytes
+	u32		m_uLength;						// Bytes Sent To The FPGA
+	u32		m_uCrc32;						// zlib CRC32 Of The Stored Bytes
+	u32		m_uFlags;
+	char	m_szName[ICE40_ARCHIVE_NAME_SIZE];
+} iCE40ArchiveEntry;
+
+typedef struct
+{
+	u32		m_uMagic;
+	u16		m_uVersion;
+	u8		m_uCount;
+	u8		m_uDefaultIndex;				// Booted When No Strap Is Fitted
+	iCE40ArchiveEntry m_entry[];
+} iCE40ArchiveHeader;
+
+static_assert(32 == sizeof(iCE40ArchiveEntry), "Entry layout must match Tools/bitstream_archive.py");
+static_assert(8 == sizeof(iCE40ArchiveHeader), "Header layout must match Tools/bitstream_archive.py");
+
+// Checks The Linked Size And Whole Archive CRC32 Against The Values Generated At Build Time.
+bool iCE40Archive_Verify(const u8* pArchive, const u32 uLinkedSize, const u32 uSize, const u32 uCrc32);
+
+// NULL If The Archive Is Invalid Or uIndex Is Out Of Range.
+const iCE40ArchiveEntry* iCE40Archive_GetEntry(const u8* pArchive, const u32 uIndex);
+
+// Straps Are Read With Pull Ups, Fitted (Low) Straps Form The Index. None Fitted Boots The Default.
+u32 iCE40Archive_SelectBoot(const u8* pArchive, const u32 uPinStrap, const u32 uNumStraps);
+
+// zlib CRC32 Worked Out By The DMA Sniffer.
+u32 iCE40Archive_Crc32(const u8* pData, const u32 uLength);
+
+// Starts The Entry Uploading Straight From Flash, No Copy Is Made. Only Call Once iCE40Archive_Verify
+// Has Passed, Its Whole Archive CRC32 Covers Every Entry.
+bool iCE40Archive_UploadStart(const u8* pArchive, const u32 uIndex);
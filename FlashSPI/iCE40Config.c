@@ -0,0 +1,369 @@
+//------------------------------------------------------------------------------------------------
+//---- iCE40Config.c (C) 2023 Dave Gaunt                                                      ----
+//------------------------------------------------------------------------------------------------
+//---- Bitstreams held in Pico flash are pulled through the XIP streaming interface, which   ----
+//---- bypasses the cache, into two RAM halves. A second DMA channel paced by the SPI TX      ----
+//---- DREQ drains them into the FIFO, so the upload runs at the SPI clock and the CPU is     ----
+//---- free while it happens. Anything else (RAM, unaligned) is sent with a single DMA.       ----
+//----                                                                                        ----
+//---- Packed bitstreams (Tools/bitstream_pack.py) use the same two halves, but each half is  ----
+//---- unpacked by the CPU in the DMA IRQ while the other one is on the wire.                 ----
+//----                                                                                        ----
+//---- Uploads start at the fastest SPI clock allowed. If CDONE stays low the FPGA is reset   ----
+//---- and the same source is sent again one PL022 divider step slower, and the rate that     ----
+//---- worked is kept in watchdog scratch so a soft reset starts from there.                  ----
+//------------------------------------------------------------------------------------------------
+
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/regs/addressmap.h"
+#include "hardware/structs/watchdog.h"
+#include "hardware/structs/xip_ctrl.h"
+
+#include "BootTimeline.h"
+#include "iCE40Config.h"
+#include "iCE40Unpack.h"
+
+#define ICE40_BOUNCE_SIZE		(4096)			// Bytes Per Half, Multiple Of 4
+#define ICE40_DMA_IRQ			(DMA_IRQ_1)
+#define ICE40_SCRATCH_MAGIC		(0x1CE40C1C)	// watchdog_hw->scratch[0], Rate In scratch[1]
+
+
+static spi_inst_t* s_pSpi = NULL;
+static u32 s_uPinCS;
+static u32 s_uPinReset;
+static u32 s_uPinCDone;
+static u32 s_uBaudRate;
+static u32 s_uMinBaudRate;
+
+static int s_iStreamChannel = -1;				// XIP Stream FIFO -> Bounce Buffer
+static int s_iSpiChannel = -1;					// Bounce Buffer -> SPI TX FIFO
+
+static u8 s_aBounceBuffer[2][ICE40_BOUNCE_SIZE] __attribute__((aligned(4)));
+
+enum ice40_source
+{
+	ICE40_SOURCE_DIRECT = 0,					// One DMA Straight From The Caller's Buffer
+	ICE40_SOURCE_STREAM,						// XIP Stream Into The Bounce Buffer
+	ICE40_SOURCE_PACKED							// Zero Run RLE Unpacked Into The Bounce Buffer
+};
+
+static enum ice40_source s_eSource;
+static const u8* s_pSource;						// Kept So A Failed Upload Can Be Sent Again
+static u32 s_uSourceSize;
+static u32 s_uLength;
+static u32 s_uQueued;							// Bytes Handed To The SPI Channel
+static u32 s_uFilled;							// Bytes Requested From The Stream
+static u32 s_uSpiHalf;
+static volatile bool s_bBusy = false;
+
+static iCE40Unpack s_unpack;
+static bool s_bUnpackError;
+
+//------------------------------------------------------------------------------------------------
+//---- iCE40Config_Fill - Queue or unpack the next block of the source into a bounce half    ----
+//------------------------------------------------------------------------------------------------
+static void iCE40Config_Fill(const u32 uHalf)
+{
+	const u32 uBytes = ((s_uLength - s_uFilled) < ICE40_BOUNCE_SIZE) ? (s_uLength - s_uFilled) : ICE40_BOUNCE_SIZE;
+
+	if (ICE40_SOURCE_STREAM == s_eSource)
+	{
+		dma_channel_set_write_addr(s_iStreamChannel, s_aBounceBuffer[uHalf], false);
+		dma_channel_set_trans_count(s_iStreamChannel, (uBytes + 3) >> 2, true);
+	}
+	else
+	{
+		const u32 uUnpacked = iCE40Unpack_Read(&s_unpack, s_aBounceBuffer[uHalf], uBytes);
+
+		// Truncated Data - Keep The Clock Count Right But The FPGA Will Not Start
+		if (uUnpacked != uBytes)
+		{
+			memset(&s_aBounceBuffer[uHalf][uUnpacked], 0, uBytes - uUnpacked);
+			s_bUnpackError = true;
+		}
+	}
+
+	s_uFilled += uBytes;
+}
+
+//------------------------------------------------------------------------------------------------
+//---- iCE40Config_SpiSend - Hand a filled bounce half to the SPI channel                     ----
+//------------------------------------------------------------------------------------------------
+static void iCE40Config_SpiSend(const u32 uHalf)
+{
+	const u32 uBytes = ((s_uLength - s_uQueued) < ICE40_BOUNCE_SIZE) ? (s_uLength - s_uQueued) : ICE40_BOUNCE_SIZE;
+
+	dma_channel_set_read_addr(s_iSpiChannel, s_aBounceBuffer[uHalf], false);
+	dma_channel_set_trans_count(s_iSpiChannel, uBytes, true);
+	s_uQueued += uBytes;
+	s_uSpiHalf = uHalf;
+}
+
+//------------------------------------------------------------------------------------------------
+//---- iCE40Config_DmaIrqHandler                                                              ----
+//------------------------------------------------------------------------------------------------
+static void iCE40Config_DmaIrqHandler(void)
+{
+	if (!dma_channel_get_irq1_status(s_iSpiChannel))
+		return;
+
+	dma_channel_acknowledge_irq1(s_iSpiChannel);
+
+	if (s_uQueued >= s_uLength)
+	{
+		s_bBusy = false;
+		return;
+	}
+
+	// The Stream Runs Several Times Faster Than SPI So The Other Half Is Normally Full Already
+	if (ICE40_SOURCE_STREAM == s_eSource)
+		dma_channel_wait_for_finish_blocking(s_iStreamChannel);
+
+	const u32 uDrainedHalf = s_uSpiHalf;
+	iCE40Config_SpiSend(uDrainedHalf ^ 1);
+
+	if (s_uFilled < s_uLength)
+		iCE40Config_Fill(uDrainedHalf);
+}
+
+//------------------------------------------------------------------------------------------------
+//---- iCE40Config_Initialise                                                                 ----
+//------------------------------------------------------------------------------------------------
+bool iCE40Config_Initialise(spi_inst_t* pSpi, const u32 uMaxBaudRate, const u32 uMinBaudRate, const u32 uPinClock, const u32 uPinMosi, const u32 uPinMiso, const u32 uPinCS, const u32 uPinReset, const u32 uPinCDone)
+{
+	s_pSpi = pSpi;
+	s_uPinCS = uPinCS;
+	s_uPinReset = uPinReset;
+	s_uPinCDone = uPinCDone;
+	s_uMinBaudRate = uMinBaudRate;
+
+	// Start From The Rate That Worked Last Time If It Is Still Within Range
+	u32 uBaudRate = uMaxBaudRate;
+	if ((ICE40_SCRATCH_MAGIC == watchdog_hw->scratch[0]) && (watchdog_hw->scratch[1] >= uMinBaudRate) && (watchdog_hw->scratch[1] <= uMaxBaudRate))
+		uBaudRate = watchdog_hw->scratch[1];
+
+	s_uBaudRate = spi_init(pSpi, uBaudRate);
+
+	gpio_init(uPinReset);
+	gpio_set_dir(uPinReset, GPIO_OUT);
+	gpio_put(uPinReset, false);
+
+	gpio_init(uPinCDone);
+	gpio_set_dir(uPinCDone, GPIO_IN);
+
+	gpio_init(uPinCS);
+	gpio_set_dir(uPinCS, GPIO_OUT);
+	gpio_put(uPinCS, true);
+
+	gpio_set_function(uPinClock, GPIO_FUNC_SPI);
+	gpio_set_function(uPinMosi, GPIO_FUNC_SPI);
+	gpio_set_function(uPinMiso, GPIO_FUNC_SPI);
+
+	s_iStreamChannel = dma_claim_unused_channel(false);
+	s_iSpiChannel = dma_claim_unused_channel(false);
+
+	if ((s_iStreamChannel < 0) || (s_iSpiChannel < 0))
+		return false;
+
+	dma_channel_config streamConfig = dma_channel_get_default_config(s_iStreamChannel);
+	channel_config_set_transfer_data_size(&streamConfig, DMA_SIZE_32);
+	channel_config_set_read_increment(&streamConfig, false);
+	channel_config_set_write_increment(&streamConfig, true);
+	channel_config_set_dreq(&streamConfig, DREQ_XIP_STREAM);
+	dma_channel_configure(s_iStreamChannel, &streamConfig, NULL, (const volatile void*)XIP_AUX_BASE, 0, false);
+
+	dma_channel_config spiConfig = dma_channel_get_default_config(s_iSpiChannel);
+	channel_config_set_transfer_data_size(&spiConfig, DMA_SIZE_8);
+	channel_config_set_read_increment(&spiConfig, true);
+	channel_config_set_write_increment(&spiConfig, false);
+	channel_config_set_dreq(&spiConfig, spi_get_dreq(pSpi, true));
+	dma_channel_configure(s_iSpiChannel, &spiConfig, &spi_get_hw(pSpi)->dr, NULL, 0, false);
+
+	irq_add_shared_handler(ICE40_DMA_IRQ, iCE40Config_DmaIrqHandler, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+	dma_channel_set_irq1_enabled(s_iSpiChannel, true);
+	irq_set_enabled(ICE40_DMA_IRQ, true);
+
+	return true;
+}
+
+//------------------------------------------------------------------------------------------------
+//---- iCE40Config_EnterSlaveMode - Reset the FPGA into SPI slave mode and reset the counters  ----
+//------------------------------------------------------------------------------------------------
+static void iCE40Config_EnterSlaveMode(const u32 uLength)
+{
+	assert(!s_bBusy);
+
+	// CS Low While Reset is Low to select Slave Mode.
+	gpio_put(s_uPinReset, false);
+	gpio_put(s_uPinCS, false);
+	sleep_us(1);
+	gpio_put(s_uPinReset, true);
+	BootTimeline_Mark(BOOT_MARK_RESET_RELEASED);
+	sleep_us(1200);					// iCE40HX requires max 1200us clearing time
+	BootTimeline_Mark(BOOT_MARK_CLEARED);
+
+	s_uLength = uLength;
+	s_uQueued = 0;
+	s_uFilled = 0;
+	s_bUnpackError = false;
+	s_bBusy = (0 != uLength);
+}
+
+//------------------------------------------------------------------------------------------------
+//---- iCE40Config_Begin - Start sending s_pSource at the current SPI clock                   ----
+//------------------------------------------------------------------------------------------------
+static void iCE40Config_Begin(void)
+{
+	const u8* pBitStream = s_pSource;
+	const u32 uLength = s_uLength;
+
+	iCE40Config_EnterSlaveMode(uLength);
+
+	if (!s_bBusy)
+		return;
+
+	if (ICE40_SOURCE_PACKED == s_eSource)
+	{
+		iCE40Unpack_Begin(&s_unpack, pBitStream, s_uSourceSize);
+
+		// The Second Half Is Unpacked While The First Is Already Going Out
+		iCE40Config_Fill(0);
+		iCE40Config_SpiSend(0);
+
+		if (s_uFilled < s_uLength)
+			iCE40Config_Fill(1);
+
+		return;
+	}
+
+	const uintptr_t uAddress = (uintptr_t)pBitStream;
+	const bool bStreamable = (uAddress >= XIP_BASE) && (uAddress < XIP_NOCACHE_NOALLOC_BASE) && (0 == (uAddress & 3));
+
+	if (!bStreamable)
+	{
+		// Already In RAM (Or Unaligned) - One Transfer Straight Into The FIFO
+		s_eSource = ICE40_SOURCE_DIRECT;
+		s_uQueued = uLength;
+		dma_channel_set_read_addr(s_iSpiChannel, pBitStream, false);
+		dma_channel_set_trans_count(s_iSpiChannel, uLength, true);
+		return;
+	}
+
+	s_eSource = ICE40_SOURCE_STREAM;
+
+	// Flush Anything Left In The Stream FIFO Then Point It At The Bitstream
+	xip_ctrl_hw->stream_ctr = 0;
+	while (!(xip_ctrl_hw->stat & XIP_STAT_FIFO_EMPTY_BITS))
+		(void)xip_ctrl_hw->stream_fifo;
+
+	xip_ctrl_hw->stream_addr = (u32)uAddress;
+	xip_ctrl_hw->stream_ctr = (uLength + 3) >> 2;
+
+	// Prime The First Half, Then Keep One Half Filling While The Other Drains
+	iCE40Config_Fill(0);
+	dma_channel_wait_for_finish_blocking(s_iStreamChannel);
+	iCE40Config_SpiSend(0);
+
+	if (s_uFilled < s_uLength)
+		iCE40Config_Fill(1);
+}
+
+//------------------------------------------------------------------------------------------------
+//---- iCE40Config_UploadStart                                                                ----
+//------------------------------------------------------------------------------------------------
+void iCE40Config_UploadStart(const u8* pBitStream, const u32 uLength)
+{
+	s_eSource = ICE40_SOURCE_STREAM;
+	s_pSource = pBitStream;
+	s_uSourceSize = uLength;
+	s_uLength = uLength;
+	iCE40Config_Begin();
+}
+
+//------------------------------------------------------------------------------------------------
+//---- iCE40Config_UploadPackedStart                                                          ----
+//------------------------------------------------------------------------------------------------
+void iCE40Config_UploadPackedStart(const u8* pPacked, const u32 uPackedSize, const u32 uLength)
+{
+	s_eSource = ICE40_SOURCE_PACKED;
+	s_pSource = pPacked;
+	s_uSourceSize = uPackedSize;
+	s_uLength = uLength;
+	iCE40Config_Begin();
+}
+
+//------------------------------------------------------------------------------------------------
+//---- iCE40Config_UploadBusy                                                                 ----
+//------------------------------------------------------------------------------------------------
+bool iCE40Config_UploadBusy(void)
+{
+	return s_bBusy;
+}
+
+//------------------------------------------------------------------------------------------------
+//---- iCE40Config_WaitDone - Let the upload drain, wake the FPGA and read CDONE              ----
+//------------------------------------------------------------------------------------------------
+static bool iCE40Config_WaitDone(void)
+{
+	while (s_bBusy)
+		tight_loop_contents();
+
+	// The DMA Finishing Only Means The Last Byte Reached The FIFO
+	while (spi_is_busy(s_pSpi))
+		tight_loop_contents();
+
+	// Nothing Was Read Back So The RX FIFO Overflowed, Drain It And Clear The Overrun
+	while (spi_is_readable(s_pSpi))
+		(void)spi_get_hw(s_pSpi)->dr;
+
+	spi_get_hw(s_pSpi)->icr = SPI_SSPICR_RORIC_BITS;
+	BootTimeline_Mark(BOOT_MARK_UPLOAD_DONE);
+
+	gpio_put(s_uPinCS, true);
+
+	// iCE40 needs at least 49 cycles with CS high to enter user mode
+	static const u8 s_aDummyPadding[8] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+	spi_write_blocking(s_pSpi, s_aDummyPadding, sizeof(s_aDummyPadding));
+	BootTimeline_Mark(BOOT_MARK_WAKE_DONE);
+
+	return gpio_get(s_uPinCDone) && !s_bUnpackError;
+}
+
+//------------------------------------------------------------------------------------------------
+//---- iCE40Config_UploadFinish                                                               ----
+//------------------------------------------------------------------------------------------------
+bool iCE40Config_UploadFinish(void)
+{
+	bool bDone = iCE40Config_WaitDone();
+
+	// A Corrupt Packed Stream Will Not Get Any Better At A Slower Clock
+	while (!bDone && !s_bUnpackError && (s_uBaudRate > s_uMinBaudRate))
+	{
+		const u32 uSlower = spi_set_baudrate(s_pSpi, s_uBaudRate - 1);
+		if ((uSlower >= s_uBaudRate) || (uSlower < s_uMinBaudRate))
+			break;
+
+		s_uBaudRate = uSlower;
+		iCE40Config_Begin();
+		bDone = iCE40Config_WaitDone();
+	}
+
+	if (bDone)
+	{
+		watchdog_hw->scratch[0] = ICE40_SCRATCH_MAGIC;
+		watchdog_hw->scratch[1] = s_uBaudRate;
+	}
+
+	return bDone;
+}
+
+//------------------------------------------------------------------------------------------------
+//---- iCE40Config_GetBaudRate                                                                ----
+//------------------------------------------------------------------------------------------------
+u32 iCE40Config_GetBaudRate(void)
+{
+	return s_uBaudRate;
+}
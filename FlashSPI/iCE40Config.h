@@ -0,0 +1,27 @@
+//------------------------------------------------------------------------------------------------
+//---- iCE40Config.h (C) 2023 Dave Gaunt                                                      ----
+//------------------------------------------------------------------------------------------------
+//---- DMA Driven iCE40 Slave SPI Configuration                                               ----
+//------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "types.h"
+#include "hardware/spi.h"
+
+// The SPI Clock Starts At uMaxBaudRate (Or The Last Rate That Worked) And Steps Down Towards
+// uMinBaudRate Whenever CDONE Fails To Rise.
+bool iCE40Config_Initialise(spi_inst_t* pSpi, const u32 uMaxBaudRate, const u32 uMinBaudRate, const u32 uPinClock, const u32 uPinMosi, const u32 uPinMiso, const u32 uPinCS, const u32 uPinReset, const u32 uPinCDone);
+
+// Puts The FPGA Into Slave SPI Mode And Starts Streaming The Bitstream, Returns Straight Away.
+void iCE40Config_UploadStart(const u8* pBitStream, const u32 uLength);
+
+// As Above For A Bitstream Packed By Tools/bitstream_pack.py, uLength Is The Unpacked Size.
+void iCE40Config_UploadPackedStart(const u8* pPacked, const u32 uPackedSize, const u32 uLength);
+
+bool iCE40Config_UploadBusy(void);
+
+// Waits For The Stream To Drain, Sends The Wake Up Clocks And Returns CDONE. While CDONE Stays
+// Low The FPGA Is Reset And The Same Bitstream Sent Again At The Next Slower Clock.
+bool iCE40Config_UploadFinish(void);
+u32 iCE40Config_GetBaudRate(void);
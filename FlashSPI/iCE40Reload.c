@@ -0,0 +1,102 @@
+//------------------------------------------------------------------------------------------------
+//---- iCE40Reload.c (C) 2023 Dave Gaunt                                                      ----
+//------------------------------------------------------------------------------------------------
+//---- Host Side Is Tools/bitstream_reload.py. The Host Sends An iCE40ReloadHeader And The    ----
+//---- Payload, We Answer With One Line: "OK CDONE=1 SPI=<hz>" Or "ERR <reason>".             ----
+//------------------------------------------------------------------------------------------------
+
+#include <stdio.h>
+#include "pico/stdlib.h"
+
+#include "iCE40Archive.h"
+#include "iCE40Config.h"
+#include "iCE40Reload.h"
+
+#define ICE40_RELOAD_TIMEOUT_US		(1000 * 1000)	// Longest Gap Allowed Mid Transfer
+
+static u8 s_aReloadBuffer[ICE40_RELOAD_MAX_SIZE] __attribute__((aligned(4)));
+static u32 s_uMagicShift = 0;
+
+//------------------------------------------------------------------------------------------------
+//---- iCE40Reload_Receive                                                                    ----
+//------------------------------------------------------------------------------------------------
+static bool iCE40Reload_Receive(u8* pDest, const u32 uLength)
+{
+	for (u32 i=0; i<uLength; ++i)
+	{
+		const int iChar = getchar_timeout_us(ICE40_RELOAD_TIMEOUT_US);
+
+		if (iChar < 0)
+			return false;
+
+		pDest[i] = (u8)iChar;
+	}
+
+	return true;
+}
+
+//------------------------------------------------------------------------------------------------
+//---- iCE40Reload_Fail                                                                       ----
+//------------------------------------------------------------------------------------------------
+static enum ice40_reload_result iCE40Reload_Fail(const char* pszReason)
+{
+	printf("ERR %s\n", pszReason);
+	stdio_flush();
+	return ICE40_RELOAD_FAILED;
+}
+
+//------------------------------------------------------------------------------------------------
+//---- iCE40Reload_Poll                                                                       ----
+//------------------------------------------------------------------------------------------------
+enum ice40_reload_result iCE40Reload_Poll(u32* puLength)
+{
+	// Hunt For The Magic A Byte At A Time So Stray Terminal Input Is Ignored
+	while (ICE40_RELOAD_MAGIC != s_uMagicShift)
+	{
+		const int iChar = getchar_timeout_us(0);
+
+		if (iChar < 0)
+			return ICE40_RELOAD_IDLE;
+
+		s_uMagicShift = (s_uMagicShift >> 8) | ((u32)iChar << 24);
+	}
+
+	s_uMagicShift = 0;
+
+	iCE40ReloadHeader header;
+	header.m_uMagic = ICE40_RELOAD_MAGIC;
+
+	if (!iCE40Reload_Receive((u8*)&header.m_uSize, sizeof(header) - sizeof(header.m_uMagic)))
+		return iCE40Reload_Fail("TIMEOUT");
+
+	// Packed Payloads Unpack To m_uLength, Which Must Still Be A Bitstream That Fits The Part
+	if ((0 == header.m_uSize) || (header.m_uSize > sizeof(s_aReloadBuffer)) || (header.m_uLength > ICE40_RELOAD_MAX_SIZE))
+		return iCE40Reload_Fail("SIZE");
+
+	if (!(header.m_uFlags & ICE40_ARCHIVE_FLAG_PACKED) && (header.m_uLength != header.m_uSize))
+		return iCE40Reload_Fail("SIZE");
+
+	if (!iCE40Reload_Receive(s_aReloadBuffer, header.m_uSize))
+		return iCE40Reload_Fail("TIMEOUT");
+
+	if (iCE40Archive_Crc32(s_aReloadBuffer, header.m_uSize) != header.m_uCrc32)
+		return iCE40Reload_Fail("CRC");
+
+	// Straight From RAM, With The Same Clock Fall Back As A Boot Upload
+	if (header.m_uFlags & ICE40_ARCHIVE_FLAG_PACKED)
+	{
+		iCE40Config_UploadPackedStart(s_aReloadBuffer, header.m_uSize, header.m_uLength);
+	}
+	else
+	{
+		iCE40Config_UploadStart(s_aReloadBuffer, header.m_uLength);
+	}
+
+	const bool bConfigured = iCE40Config_UploadFinish();
+
+	printf("%s CDONE=%d SPI=%u\n", bConfigured ? "OK" : "ERR", bConfigured ? 1 : 0, (unsigned int)iCE40Config_GetBaudRate());
+	stdio_flush();
+
+	*puLength = header.m_uLength;
+	return bConfigured ? ICE40_RELOAD_CONFIGURED : ICE40_RELOAD_FAILED;
+}
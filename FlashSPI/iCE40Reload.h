@@ -0,0 +1,33 @@
+//------------------------------------------------------------------------------------------------
+//---- iCE40Reload.h (C) 2023 Dave Gaunt                                                      ----
+//------------------------------------------------------------------------------------------------
+//---- Receives A Bitstream Over USB CDC Into RAM And Reconfigures The FPGA From It           ----
+//------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "types.h"
+
+#define ICE40_RELOAD_MAGIC		(0x4C303449)		// "I40L"
+#define ICE40_RELOAD_MAX_SIZE	(136 * 1024)		// Largest iCE40HX8K Bitstream Is 135100 Bytes
+
+// Sent Ahead Of The Payload, Fields Mean The Same As In An iCE40ArchiveEntry.
+typedef struct
+{
+	u32		m_uMagic;
+	u32		m_uSize;						// Payload Bytes That Follow
+	u32		m_uLength;						// Bytes Sent To The FPGA
+	u32		m_uCrc32;						// zlib CRC32 Of The Payload
+	u32		m_uFlags;						// ICE40_ARCHIVE_FLAG_PACKED
+} iCE40ReloadHeader;
+
+enum ice40_reload_result
+{
+	ICE40_RELOAD_IDLE = 0,					// Nothing Arrived
+	ICE40_RELOAD_CONFIGURED,				// New Bitstream Loaded And CDONE Is High
+	ICE40_RELOAD_FAILED						// Transfer Or Configuration Failed
+};
+
+// Call From The Main Loop. Returns Straight Away Unless A Header Has Started Arriving, Then
+// Receives The Whole Bitstream, Reconfigures The FPGA And Replies With One Text Line.
+enum ice40_reload_result iCE40Reload_Poll(u32* puLength);
@@ -0,0 +1,81 @@
+//------------------------------------------------------------------------------------------------
+//---- iCE40Unpack.c (C) 2023 Dave Gaunt                                                      ----
+//------------------------------------------------------------------------------------------------
+
+#include <string.h>
+
+#include "iCE40Unpack.h"
+
+//------------------------------------------------------------------------------------------------
+//---- iCE40Unpack_Begin                                                                      ----
+//------------------------------------------------------------------------------------------------
+void iCE40Unpack_Begin(iCE40Unpack* pUnpack, const u8* pPacked, const u32 uPackedSize)
+{
+	pUnpack->m_pPacked = pPacked;
+	pUnpack->m_pPackedEnd = pPacked + uPackedSize;
+	pUnpack->m_uRunLeft = 0;
+	pUnpack->m_bRunLiteral = false;
+}
+
+//------------------------------------------------------------------------------------------------
+//---- iCE40Unpack_Read                                                                       ----
+//------------------------------------------------------------------------------------------------
+u32 iCE40Unpack_Read(iCE40Unpack* pUnpack, u8* pDest, const u32 uSpace)
+{
+	u32 uWritten = 0;
+
+	while (uWritten < uSpace)
+	{
+		if (0 == pUnpack->m_uRunLeft)
+		{
+			if (pUnpack->m_pPacked >= pUnpack->m_pPackedEnd)
+				break;
+
+			const u8 uToken = *pUnpack->m_pPacked++;
+
+			if (0 == (uToken & 0x80))
+			{
+				pUnpack->m_uRunLeft = uToken + 1;
+				pUnpack->m_bRunLiteral = true;
+			}
+			else if (0 == (uToken & 0x40))
+			{
+				pUnpack->m_uRunLeft = (uToken & 0x3F) + 1;
+				pUnpack->m_bRunLiteral = false;
+			}
+			else
+			{
+				// Truncated Token, The Caller Sees The Short Read
+				if (pUnpack->m_pPacked >= pUnpack->m_pPackedEnd)
+					break;
+
+				pUnpack->m_uRunLeft = (((uToken & 0x3F) << 8) | *pUnpack->m_pPacked++) + 65;
+				pUnpack->m_bRunLiteral = false;
+			}
+		}
+
+		u32 uCount = (pUnpack->m_uRunLeft < (uSpace - uWritten)) ? pUnpack->m_uRunLeft : (uSpace - uWritten);
+
+		if (pUnpack->m_bRunLiteral)
+		{
+			// A Literal Run Can't Read Past The Packed Data Either
+			const u32 uPackedLeft = (u32)(pUnpack->m_pPackedEnd - pUnpack->m_pPacked);
+
+			if (0 == uPackedLeft)
+				break;
+
+			uCount = (uCount < uPackedLeft) ? uCount : uPackedLeft;
+			memcpy(pDest + uWritten, pUnpack->m_pPacked, uCount);
+			pUnpack->m_pPacked += uCount;
+		}
+		else
+		{
+			memset(pDest + uWritten, 0, uCount);
+		}
+
+		uWritten += uCount;
+		pUnpack->m_uRunLeft -= uCount;
+	}
+
+	return uWritten;
+}
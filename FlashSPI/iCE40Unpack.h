@@ -0,0 +1,22 @@
+//------------------------------------------------------------------------------------------------
+//---- iCE40Unpack.h (C) 2023 Dave Gaunt                                                      ----
+//------------------------------------------------------------------------------------------------
+//---- Resumable Zero Run RLE Decoder, See Tools/bitstream_pack.py For The Format             ----
+//------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "types.h"
+
+typedef struct
+{
+	const u8*	m_pPacked;					// Next Token Or Literal Byte
+	const u8*	m_pPackedEnd;
+	u32			m_uRunLeft;					// Bytes Left In The Current Token
+	bool		m_bRunLiteral;
+} iCE40Unpack;
+
+void iCE40Unpack_Begin(iCE40Unpack* pUnpack, const u8* pPacked, const u32 uPackedSize);
+
+// Unpacks Up To uSpace Bytes, Returns Fewer Only When The Packed Data Runs Out.
+u32 iCE40Unpack_Read(iCE40Unpack* pUnpack, u8* pDest, const u32 uSpace);